@@ -0,0 +1,45 @@
+#!/usr/bin/env bash
+# Measures how long BMShooterServer takes to be ready and how much memory it holds once it is, averaged over a few runs.
+# Run it on two builds to compare them, e.g. before and after moving assets to soft references.
+#
+# usage: Scripts/MeasureServerStartup.sh [runs] [map]
+
+set -euo pipefail
+
+RUNS=${1:-5}
+MAP=${2:-/Game/FirstPersonCPP/Maps/FirstPersonExampleMap}
+
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+SERVER="$PROJECT_DIR/Binaries/Linux/BMShooterServer"
+LOG_DIR="$PROJECT_DIR/Saved/Logs"
+
+TOTAL_SECONDS=0
+TOTAL_RSS_KB=0
+for RUN in $(seq 1 "$RUNS"); do
+	LOG="$LOG_DIR/ServerStartup_$RUN.log"
+	rm -f "$LOG"
+
+	"$SERVER" "$MAP" -unattended -log=ServerStartup_$RUN.log &
+	SERVER_PID=$!
+
+	# the game mode logs the time since launch when the match starts
+	until grep -q "Server ready in" "$LOG" 2>/dev/null; do
+		if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+			echo "server exited before it was ready, see $LOG" >&2
+			exit 1
+		fi
+		sleep 0.2
+	done
+
+	SECONDS_READY=$(grep -o "Server ready in [0-9.]*" "$LOG" | awk '{ print $4 }')
+	RSS_KB=$(awk '/VmRSS/ { print $2 }' "/proc/$SERVER_PID/status")
+	echo "run $RUN: ready in ${SECONDS_READY} s, ${RSS_KB} KB resident"
+
+	TOTAL_SECONDS=$(echo "$TOTAL_SECONDS + $SECONDS_READY" | bc)
+	TOTAL_RSS_KB=$((TOTAL_RSS_KB + RSS_KB))
+
+	kill "$SERVER_PID" 2>/dev/null || true
+	wait "$SERVER_PID" 2>/dev/null || true
+done
+
+echo "average: ready in $(echo "scale=2; $TOTAL_SECONDS / $RUNS" | bc) s, $((TOTAL_RSS_KB / RUNS)) KB resident"
@@ -0,0 +1,36 @@
+#!/usr/bin/env bash
+# Runs a local load test: one BMShooterServer with N bots and M headless clients on localhost.
+# The server writes its CSV to Saved/LoadTest when the run ends. Run it with move_compression 0 and 1 to compare
+# the inbound bytes and server move time of the stock and the compressed character movement.
+#
+# usage: Scripts/RunLoadTest.sh [bots] [clients] [duration_seconds] [map] [move_compression]
+
+set -euo pipefail
+
+BOTS=${1:-16}
+CLIENTS=${2:-8}
+DURATION=${3:-120}
+MAP=${4:-/Game/FirstPersonCPP/Maps/FirstPersonExampleMap}
+MOVE_COMPRESSION=${5:-1}
+
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+SERVER="$PROJECT_DIR/Binaries/Linux/BMShooterServer"
+CLIENT="$PROJECT_DIR/Binaries/Linux/BMShooter"
+
+"$SERVER" "$MAP" -log -unattended -bmloadtest -bmbots="$BOTS" -bmloadtestduration="$DURATION" -ExecCmds="bm.MoveCompression $MOVE_COMPRESSION" &
+SERVER_PID=$!
+
+# give the server time to load the map before clients connect
+sleep 10
+
+CLIENT_PIDS=()
+for ((i = 0; i < CLIENTS; i++)); do
+	"$CLIENT" 127.0.0.1 -nullrhi -nosound -unattended -nosplash -log=LoadTestClient_$i.log -ExecCmds="bm.MoveCompression $MOVE_COMPRESSION" &
+	CLIENT_PIDS+=($!)
+done
+
+wait "$SERVER_PID" || true
+
+for pid in "${CLIENT_PIDS[@]}"; do
+	kill "$pid" 2>/dev/null || true
+done
@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+# Measures projectile prediction under emulated latency: one BMShooterServer and one client holding fire.
+# The client logs the divergence of every reconciled shot to PredictionTestClient.log (grep "divergence").
+#
+# usage: Scripts/RunPredictionTest.sh [lag_ms] [loss_percent] [duration_seconds] [map]
+
+set -euo pipefail
+
+LAG=${1:-120}
+LOSS=${2:-1}
+DURATION=${3:-60}
+MAP=${4:-/Game/FirstPersonCPP/Maps/FirstPersonExampleMap}
+
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+SERVER="$PROJECT_DIR/Binaries/Linux/BMShooterServer"
+CLIENT="$PROJECT_DIR/Binaries/Linux/BMShooter"
+
+"$SERVER" "$MAP" -log -unattended &
+SERVER_PID=$!
+
+# give the server time to load the map before the client connects
+sleep 10
+
+"$CLIENT" 127.0.0.1 -nullrhi -nosound -unattended -nosplash -log=PredictionTestClient.log \
+	-ExecCmds="Net PktLag=$LAG, Net PktLoss=$LOSS, bm.Prediction.Log 1, bm.Prediction.AutoFire 1" &
+CLIENT_PID=$!
+
+sleep "$DURATION"
+
+kill "$CLIENT_PID" 2>/dev/null || true
+kill "$SERVER_PID" 2>/dev/null || true
@@ -0,0 +1,35 @@
+#!/usr/bin/env bash
+# Measures the client frame time gained by character significance: one BMShooterServer with N bots and one rendering
+# client that captures a CSV profile with bm.Significance 0 and then 1. The captures land in Saved/Profiling/CSV.
+#
+# usage: Scripts/RunSignificanceBenchmark.sh [bots] [capture_frames] [map]
+
+set -euo pipefail
+
+BOTS=${1:-64}
+FRAMES=${2:-1800}
+MAP=${3:-/Game/FirstPersonCPP/Maps/FirstPersonExampleMap}
+
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+SERVER="$PROJECT_DIR/Binaries/Linux/BMShooterServer"
+CLIENT="$PROJECT_DIR/Binaries/Linux/BMShooter"
+
+# no duration, the server runs until the captures are done
+"$SERVER" "$MAP" -log -unattended -bmloadtest -bmbots="$BOTS" &
+SERVER_PID=$!
+
+# give the server time to load the map and spawn the bots before the client connects
+sleep 15
+
+for SIGNIFICANCE in 0 1; do
+	"$CLIENT" 127.0.0.1 -nosound -unattended -nosplash -log=SignificanceBenchmark_$SIGNIFICANCE.log \
+		-ExecCmds="bm.Significance $SIGNIFICANCE, t.MaxFPS 0, CsvProfile Frames=$FRAMES" &
+	CLIENT_PID=$!
+
+	# connect, capture at 60 fps or better, then some margin to write the file
+	sleep $((20 + FRAMES / 60))
+	kill "$CLIENT_PID" 2>/dev/null || true
+	wait "$CLIENT_PID" 2>/dev/null || true
+done
+
+kill "$SERVER_PID" 2>/dev/null || true
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BMShooterBotController.h"
+#include "BMShooterCharacter.h"
+#include "NavigationSystem.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "EngineUtils.h"
+#include "TimerManager.h"
+
+ABMShooterBotController::ABMShooterBotController() {
+	// so bots show up like players
+	bWantsPlayerState = true;
+
+	thinkInterval = 0.25f;
+	wanderRadius = 3000.0f;
+	engageDistance = 4000.0f;
+	fireInterval = 0.3f;
+}
+
+void ABMShooterBotController::BeginPlay() {
+	Super::BeginPlay();
+
+	// spread the bots over different frames
+	GetWorldTimerManager().SetTimer(thinkTimer, this, &ABMShooterBotController::Think, thinkInterval, true, FMath::FRandRange(0.0f, thinkInterval));
+}
+
+void ABMShooterBotController::Think() {
+	ABMShooterCharacter* self = Cast<ABMShooterCharacter>(GetPawn());
+	if (!self || self->characterDead) {
+		ClearFocus(EAIFocusPriority::Gameplay);
+		return;
+	}
+
+	if (GetMoveStatus() == EPathFollowingStatus::Idle) {
+		MoveToRandomLocation(self);
+	}
+
+	ABMShooterCharacter* enemy = FindClosestVisibleEnemy(self);
+	if (!enemy) {
+		ClearFocus(EAIFocusPriority::Gameplay);
+		return;
+	}
+
+	// the focus drives the control rotation, so the shot goes where the bot looks
+	SetFocus(enemy);
+
+	const float now = GetWorld()->GetTimeSeconds();
+	if (now - lastFireTime >= fireInterval) {
+		lastFireTime = now;
+		self->OnFire();
+	}
+}
+
+ABMShooterCharacter* ABMShooterBotController::FindClosestVisibleEnemy(const ABMShooterCharacter* self) const {
+	ABMShooterCharacter* closestEnemy = nullptr;
+	float closestDistanceSquared = FMath::Square(engageDistance);
+
+	for (TActorIterator<ABMShooterCharacter> it(GetWorld()); it; ++it) {
+		ABMShooterCharacter* character = *it;
+		if (character == self || character->characterDead) {
+			continue;
+		}
+
+		const float distanceSquared = FVector::DistSquared(character->GetActorLocation(), self->GetActorLocation());
+		if (distanceSquared < closestDistanceSquared && LineOfSightTo(character)) {
+			closestDistanceSquared = distanceSquared;
+			closestEnemy = character;
+		}
+	}
+
+	return closestEnemy;
+}
+
+void ABMShooterBotController::MoveToRandomLocation(const ABMShooterCharacter* self) {
+	UNavigationSystemV1* navigationSystem = UNavigationSystemV1::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (!navigationSystem) {
+		return;
+	}
+
+	FNavLocation destination;
+	if (navigationSystem->GetRandomReachablePointInRadius(self->GetActorLocation(), wanderRadius, destination)) {
+		MoveToLocation(destination.Location);
+	}
+}
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "BMShooterBotController.generated.h"
+
+class ABMShooterCharacter;
+
+/**
+ * Load test bot: wanders the navmesh, aims at the closest enemy it can see and shoots through
+ * the same ABMShooterCharacter::OnFire path as players.
+ */
+UCLASS()
+class BMSHOOTER_API ABMShooterBotController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	ABMShooterBotController();
+
+protected:
+	virtual void BeginPlay() override;
+
+	// Picks a destination, a target and fires when possible
+	void Think();
+
+	ABMShooterCharacter* FindClosestVisibleEnemy(const ABMShooterCharacter* self) const;
+
+	void MoveToRandomLocation(const ABMShooterCharacter* self);
+
+protected:
+	// Seconds between two decisions
+	UPROPERTY(EditDefaultsOnly, Category = Bot)
+	float thinkInterval;
+
+	// Max distance of a new destination
+	UPROPERTY(EditDefaultsOnly, Category = Bot)
+	float wanderRadius;
+
+	// Max distance at which an enemy gets shot
+	UPROPERTY(EditDefaultsOnly, Category = Bot)
+	float engageDistance;
+
+	// Seconds between two shots
+	UPROPERTY(EditDefaultsOnly, Category = Bot)
+	float fireInterval;
+
+	FTimerHandle thinkTimer;
+
+	float lastFireTime = 0.0f;
+};
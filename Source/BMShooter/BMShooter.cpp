@@ -2,6 +2,37 @@
 
 #include "BMShooter.h"
 #include "Modules/ModuleManager.h"
+#include "BMShooterStats.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, BMShooter, "BMShooter" );
+CSV_DEFINE_CATEGORY_MODULE(BMSHOOTER_API, BMShooter, true);
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+DECLARE_LLM_MEMORY_STAT(TEXT("BMShooter"), STAT_BMShooterSummaryLLM, STATGROUP_LLM);
+DECLARE_LLM_MEMORY_STAT(TEXT("BMCharacters"), STAT_BMCharactersLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("BMProjectiles"), STAT_BMProjectilesLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("BMHealth"), STAT_BMHealthLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("BMCosmetics"), STAT_BMCosmeticsLLM, STATGROUP_LLMFULL);
+
+// names the module's tags in stat LLM/LLMFULL and the LLM CSV
+static void RegisterBMShooterLLMTags() {
+	FLowLevelMemTracker& tracker = FLowLevelMemTracker::Get();
+	const FName summaryStat = GET_STATFNAME(STAT_BMShooterSummaryLLM);
+	tracker.RegisterProjectTag((int32)EBMLLMTag::Characters, TEXT("BMCharacters"), GET_STATFNAME(STAT_BMCharactersLLM), summaryStat);
+	tracker.RegisterProjectTag((int32)EBMLLMTag::Projectiles, TEXT("BMProjectiles"), GET_STATFNAME(STAT_BMProjectilesLLM), summaryStat);
+	tracker.RegisterProjectTag((int32)EBMLLMTag::Health, TEXT("BMHealth"), GET_STATFNAME(STAT_BMHealthLLM), summaryStat);
+	tracker.RegisterProjectTag((int32)EBMLLMTag::Cosmetics, TEXT("BMCosmetics"), GET_STATFNAME(STAT_BMCosmeticsLLM), summaryStat);
+}
+#endif
+
+class FBMShooterModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override {
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+		RegisterBMShooterLLMTags();
+#endif
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FBMShooterModule, BMShooter, "BMShooter" );
  
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "BMShooterCharacter.h"
 #include "BMShooterProjectile.h"
 #include "Animation/AnimInstance.h"
+#include "Animation/AnimMontage.h"
+#include "Sound/SoundBase.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InputComponent.h"
@@ -12,16 +14,102 @@
 #include "DrawDebugHelpers.h"
 #include "Net/UnrealNetwork.h"
 #include "Components/HealthComponent.h"
-#include "TimerManager.h"
-#include "NavigationSystem.h"
+#include "Components/BMShooterMovementComponent.h"
+#include "Subsystems/SpawnPointSubsystem.h"
+#include "Subsystems/RagdollBudgetSubsystem.h"
+#include "Subsystems/HealthEffectSubsystem.h"
+#include "Subsystems/CharacterSignificanceSubsystem.h"
+#include "Subsystems/CharacterSpatialHashSubsystem.h"
+#include "Subsystems/ProjectilePoolSubsystem.h"
+#include "Subsystems/ProjectileSimulationSubsystem.h"
+#include "BMShooterShotStream.h"
+#include "Subsystems/LagCompensationSubsystem.h"
+#include "Components/HitboxHistoryComponent.h"
+#include "BMShooterReplicationGraph.h"
+#include "Subsystems/CombatEventSubsystem.h"
+#include "Subsystems/CosmeticEventSubsystem.h"
+#include "Subsystems/ReplayBufferSubsystem.h"
+#include "LoadTest/BMLoadTestRecorder.h"
+#include "BMShooterStats.h"
+#include "CombatCore/CombatRules.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/GameSession.h"
+#include "Engine/World.h"
+#include "Engine/AssetManager.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogFPChar, Warning, All);
 
+DECLARE_CYCLE_STAT(TEXT("Character HealthModified"), STAT_HealthModified, STATGROUP_BMShooter);
+DECLARE_CYCLE_STAT(TEXT("Character RespawnCharacter"), STAT_RespawnCharacter, STATGROUP_BMShooter);
+DECLARE_CYCLE_STAT(TEXT("Character ActivateRagdoll"), STAT_ActivateRagdoll, STATGROUP_BMShooter);
+DECLARE_CYCLE_STAT(TEXT("Character ResetCharacter"), STAT_ResetCharacter, STATGROUP_BMShooter);
+DECLARE_CYCLE_STAT(TEXT("Character UpdateReplicatedAim"), STAT_UpdateReplicatedAim, STATGROUP_BMShooter);
+DECLARE_CYCLE_STAT(TEXT("Character ServerFireShots"), STAT_ServerFireShots, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character HealthModified Calls"), STAT_HealthModifiedCalls, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character Respawns"), STAT_RespawnCharacterCalls, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character Ragdolls Activated"), STAT_ActivateRagdollCalls, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character Resets"), STAT_ResetCharacterCalls, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character Aim Updates Sent"), STAT_AimUpdatesSent, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character Aim Updates Received"), STAT_AimUpdatesReceived, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character ServerFireShots Calls"), STAT_ServerFireShotsCalls, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character Shots Fired"), STAT_ShotsFired, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character Shots Rejected"), STAT_ShotsRejected, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Predicted Projectiles Merged"), STAT_PredictionsMerged, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Predicted Projectiles Replaced"), STAT_PredictionsReplaced, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Predicted Projectiles Rejected"), STAT_PredictionsRejected, STATGROUP_BMShooter);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Predicted Projectile Divergence"), STAT_PredictionDivergence, STATGROUP_BMShooter);
+
+#if !UE_BUILD_SHIPPING
+static TAutoConsoleVariable<int32> CVarPredictionAutoFire(
+	TEXT("bm.Prediction.AutoFire"),
+	0,
+	TEXT("Holds the fire input of the local player, to measure projectile prediction under Net PktLag / PktLoss"));
+
+static TAutoConsoleVariable<int32> CVarPredictionLog(
+	TEXT("bm.Prediction.Log"),
+	0,
+	TEXT("Logs how far each predicted projectile was from the server one"));
+
+// Running totals of the projectile reconciliations on this client, see bm.PredictionStats
+struct FBMPredictionStats
+{
+	int32 numMerged = 0;
+	int32 numReplaced = 0;
+	int32 numRejected = 0;
+	float totalDivergence = 0.0f;
+	float maxDivergence = 0.0f;
+
+	void Log() const {
+		const int32 numReconciled = numMerged + numReplaced;
+		UE_LOG(LogFPChar, Warning, TEXT("Predicted projectiles: %d merged, %d replaced, %d rejected, divergence avg %.1f max %.1f"),
+			numMerged, numReplaced, numRejected, numReconciled > 0 ? totalDivergence / numReconciled : 0.0f, maxDivergence);
+	}
+};
+static FBMPredictionStats GPredictionStats;
+
+static FAutoConsoleCommand PredictionStatsCommand(
+	TEXT("bm.PredictionStats"),
+	TEXT("bm.PredictionStats [reset]: logs the projectile prediction totals of this client"),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& args) {
+		GPredictionStats.Log();
+		if (args.Num() > 0 && args[0] == TEXT("reset")) {
+			GPredictionStats = FBMPredictionStats();
+		}
+	})
+);
+#endif
+
 //////////////////////////////////////////////////////////////////////////
 // ABMShooterCharacter
 
-ABMShooterCharacter::ABMShooterCharacter()
+ABMShooterCharacter::ABMShooterCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UBMShooterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
+	BM_LLM_SCOPE(Characters);
+
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(55.f, 96.0f);
 
@@ -29,41 +117,47 @@ ABMShooterCharacter::ABMShooterCharacter()
 	BaseTurnRate = 45.f;
 	BaseLookUpRate = 45.f;
 
-	// Create a CameraComponent	
-	FirstPersonCameraComponent = CreateDefaultSubobject<UCameraComponent>(TEXT("FirstPersonCamera"));
-	FirstPersonCameraComponent->SetupAttachment(GetCapsuleComponent());
-	FirstPersonCameraComponent->SetRelativeLocation(FVector(-39.56f, 1.75f, 64.f)); // Position the camera
-	FirstPersonCameraComponent->bUsePawnControlRotation = true;
-
-	// Create a mesh component that will be used when being viewed from a '1st person' view (when controlling this pawn)
-	FPMesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("CharacterMesh1P"));
-	FPMesh->SetOnlyOwnerSee(true);
-	FPMesh->SetupAttachment(FirstPersonCameraComponent);
-	FPMesh->bCastDynamicShadow = false;
-	FPMesh->CastShadow = false;
-	FPMesh->SetRelativeRotation(FRotator(1.9f, -19.19f, 5.2f));
-	FPMesh->SetRelativeLocation(FVector(-0.5f, -4.4f, -155.7f));
-	FPMesh->SetCollisionObjectType(ECC_Pawn);
-
-	// Create a gun mesh component
-	FPGun = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("FPGun"));
-	FPGun->SetOnlyOwnerSee(true);			// only the owning player will see this mesh
-	FPGun->bCastDynamicShadow = false;
-	FPGun->CastShadow = false;
-	FPGun->SetupAttachment(RootComponent);
-
-	FPMuzzleLocation = CreateDefaultSubobject<USceneComponent>(TEXT("MuzzleLocation"));
-	FPMuzzleLocation->SetupAttachment(FPGun);
-	FPMuzzleLocation->SetRelativeLocation(FVector(0.2f, 48.4f, -10.6f));
+#if !UE_SERVER
+	{
+		BM_LLM_SCOPE(Cosmetics);
+
+		// Create a CameraComponent	
+		FirstPersonCameraComponent = CreateDefaultSubobject<UCameraComponent>(TEXT("FirstPersonCamera"));
+		FirstPersonCameraComponent->SetupAttachment(GetCapsuleComponent());
+		FirstPersonCameraComponent->SetRelativeLocation(FVector(-39.56f, 1.75f, 64.f)); // Position the camera
+		FirstPersonCameraComponent->bUsePawnControlRotation = true;
+
+		// Create a mesh component that will be used when being viewed from a '1st person' view (when controlling this pawn)
+		FPMesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("CharacterMesh1P"));
+		FPMesh->SetOnlyOwnerSee(true);
+		FPMesh->SetupAttachment(FirstPersonCameraComponent);
+		FPMesh->bCastDynamicShadow = false;
+		FPMesh->CastShadow = false;
+		FPMesh->SetRelativeRotation(FRotator(1.9f, -19.19f, 5.2f));
+		FPMesh->SetRelativeLocation(FVector(-0.5f, -4.4f, -155.7f));
+		FPMesh->SetCollisionObjectType(ECC_Pawn);
+
+		// Create a gun mesh component
+		FPGun = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("FPGun"));
+		FPGun->SetOnlyOwnerSee(true);			// only the owning player will see this mesh
+		FPGun->bCastDynamicShadow = false;
+		FPGun->CastShadow = false;
+		FPGun->SetupAttachment(RootComponent);
+
+		FPMuzzleLocation = CreateDefaultSubobject<USceneComponent>(TEXT("MuzzleLocation"));
+		FPMuzzleLocation->SetupAttachment(FPGun);
+		FPMuzzleLocation->SetRelativeLocation(FVector(0.2f, 48.4f, -10.6f));
+
+		// third person gun mesh seen by others
+		TPGun = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("TPGun"));
+		TPGun->SetOwnerNoSee(true);
+		TPGun->SetupAttachment(GetMesh(), TEXT("RightHand"));
+	}
+#endif
 
 	// Default offset from the character location for projectiles to spawn
 	GunOffset = FVector(100.0f, 0.0f, 10.0f);
 
-	// third person gun mesh seen by others
-	TPGun = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("TPGun"));
-	TPGun->SetOwnerNoSee(true);
-	TPGun->SetupAttachment(GetMesh(), TEXT("RightHand"));
-
 	healthComponent = CreateDefaultSubobject<UHealthComponent>(TEXT("HealthComponent"));
 	if (healthComponent) {
 		healthComponent->SetIsReplicated(true);
@@ -72,24 +166,88 @@ ABMShooterCharacter::ABMShooterCharacter()
 		healthComponent->OnHealthModifiedDelegate.AddDynamic(this, &ABMShooterCharacter::HealthModified);
 	}
 
+	hitboxHistory = CreateDefaultSubobject<UHitboxHistoryComponent>(TEXT("HitboxHistory"));
+
 	respawnTime = 10.0f;
 	characterDead = false;
+
+	fireMode = EBMFireMode::Projectile;
+	hitscanDamage = 20.0f;
+	hitscanRange = 10000.0f;
+	shotMaxOriginError = 150.0f;
+
+	fireRate = 10.0f;
+	bAutomaticFire = true;
+	magazineSize = 30;
+	reloadTime = 2.0f;
+	ammo = magazineSize;
+	shotBatchInterval = 0.1f;
+	maxShotsPerBatch = 8;
+	bPredictProjectiles = true;
+	predictionMergeTolerance = 100.0f;
+
+	projectilePoolSize = 16;
+
+	aimReplicationRate = 20.0f;
+	aimReplicationThreshold = 0.5f;
+	aimInterpSpeed = 15.0f;
 }
 
 void ABMShooterCharacter::BeginPlay()
 {
+	BM_LLM_SCOPE(Characters);
+
 	// Call the base class  
 	Super::BeginPlay();
 	
-	//Attach gun mesh component to Skeleton, doing it here because the skeleton is not yet created in the constructor
-	FPGun->AttachToComponent(FPMesh, FAttachmentTransformRules(EAttachmentRule::SnapToTarget, true), TEXT("GripPoint"));
-	FPGun->SetHiddenInGame(false);
+	if (IsNetMode(NM_DedicatedServer)) {
+		DisableCosmeticComponents();
 
-	TPGun->SetOwnerNoSee(true);
-	
-	// hide third person mesh
-	GetMesh()->SetOwnerNoSee(true);
+		// nobody renders the mesh here and hits are validated against the capsule history, montages still tick for their notifies
+		GetMesh()->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered;
+	}
+	else {
+		//Attach gun mesh component to Skeleton, doing it here because the skeleton is not yet created in the constructor
+		if (FPGun && FPMesh) {
+			FPGun->AttachToComponent(FPMesh, FAttachmentTransformRules(EAttachmentRule::SnapToTarget, true), TEXT("GripPoint"));
+			FPGun->SetHiddenInGame(false);
+		}
+
+		if (TPGun) {
+			TPGun->SetOwnerNoSee(true);
+		}
+
+		// hide third person mesh
+		GetMesh()->SetOwnerNoSee(true);
+
+		LoadCosmeticAssets();
+	}
+
+	// make sure the pool is warm for a full lobby before the first shot. It is only sized once, every character asks for
+	// the same count. Shot stream projectiles have no actor to pool
+	if (GetLocalRole() == ROLE_Authority && ProjectileClass != NULL && !ABMShooterShotStream::IsEnabled()) {
+		UProjectilePoolSubsystem* projectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>();
+		const AGameModeBase* gameMode = GetWorld()->GetAuthGameMode();
+		const int32 maxPlayers = gameMode && gameMode->GameSession ? gameMode->GameSession->MaxPlayers : 0;
+		if (projectilePool) {
+			// no session falls back to the pool's defaultPrewarmCount
+			projectilePool->Prewarm(ProjectileClass, projectilePoolSize * maxPlayers);
+		}
+	}
+
+	// radial damage looks characters up in the hash instead of running overlap queries
+	if (GetLocalRole() == ROLE_Authority) {
+		UCharacterSpatialHashSubsystem* characterHash = GetWorld()->GetSubsystem<UCharacterSpatialHashSubsystem>();
+		if (characterHash) {
+			characterHash->RegisterCharacter(this);
+		}
+	}
 
+	// tick, animation and net rates follow how much this character matters to each viewer
+	UCharacterSignificanceSubsystem* significance = GetWorld()->GetSubsystem<UCharacterSignificanceSubsystem>();
+	if (significance) {
+		significance->RegisterCharacter(this);
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -105,7 +263,8 @@ void ABMShooterCharacter::SetupPlayerInputComponent(class UInputComponent* Playe
 	PlayerInputComponent->BindAction("Jump", IE_Released, this, &ACharacter::StopJumping);
 
 	// Bind fire event
-	PlayerInputComponent->BindAction("Fire", IE_Pressed, this, &ABMShooterCharacter::OnFire);
+	PlayerInputComponent->BindAction("Fire", IE_Pressed, this, &ABMShooterCharacter::StartFire);
+	PlayerInputComponent->BindAction("Fire", IE_Released, this, &ABMShooterCharacter::StopFire);
 
 	// Bind movement events
 	PlayerInputComponent->BindAxis("MoveForward", this, &ABMShooterCharacter::MoveForward);
@@ -120,13 +279,374 @@ void ABMShooterCharacter::SetupPlayerInputComponent(class UInputComponent* Playe
 	PlayerInputComponent->BindAxis("LookUpRate", this, &ABMShooterCharacter::LookUpAtRate);
 }
 
+void ABMShooterCharacter::StartFire() {
+	bWantsToFire = true;
+	OnFire();
+}
+
+void ABMShooterCharacter::StopFire() {
+	bWantsToFire = false;
+	FlushShots();
+}
+
+float ABMShooterCharacter::GetServerTime() const {
+	AGameStateBase* gameState = GetWorld()->GetGameState();
+	return gameState ? gameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+}
+
+bool ABMShooterCharacter::CanFire(float now) const {
+	if (characterDead || ammo <= 0 || fireRate <= 0.0f) {
+		return false;
+	}
+	if (fireMode == EBMFireMode::Projectile && ProjectileClass == NULL) {
+		return false;
+	}
+	return now - lastFireTime >= 1.0f / fireRate;
+}
+
+void ABMShooterCharacter::GetShotOriginAndDirection(FVector& outOrigin, FVector& outDirection) const {
+	FRotator rotation;
+	GetActorEyesViewPoint(outOrigin, rotation);
+	outDirection = rotation.Vector();
+
+	// hitscan shots leave from the eyes so they go where the crosshair is, projectiles from the gun
+	if (fireMode == EBMFireMode::Projectile) {
+		outOrigin = FPMuzzleLocation ? FPMuzzleLocation->GetComponentLocation() : outOrigin + rotation.RotateVector(GunOffset);
+	}
+}
+
 void ABMShooterCharacter::OnFire()
 {
-	// try and fire a projectile
-	if (ProjectileClass != NULL)
-	{
-		// call bp event
-		Fire();
+	const float now = GetServerTime();
+	if (!CanFire(now)) {
+		return;
+	}
+
+	lastFireTime = now;
+	BM_COUNT_CALL(STAT_ShotsFired);
+
+	FVector origin;
+	FVector direction;
+	GetShotOriginAndDirection(origin, direction);
+	PlayFireCosmetics(origin, direction);
+
+	if (GetLocalRole() == ROLE_Authority) {
+		// bots and the listen server host don't need the RPC
+		if (ValidateShot(now)) {
+			ProcessShot(origin, direction, now, 0);
+		}
+		return;
+	}
+
+	// 0 means not predicted
+	lastShotId = lastShotId == MAX_uint16 ? 1 : lastShotId + 1;
+	if (fireMode == EBMFireMode::Projectile && bPredictProjectiles) {
+		SpawnPredictedProjectile(lastShotId, origin, direction);
+	}
+
+	// predicted, the server corrects it if it disagrees
+	ammo--;
+	if (ammo <= 0) {
+		reloadEndTime = now + reloadTime;
+	}
+
+	if (pendingShots.Num() == 0) {
+		pendingShotsBaseTime = now;
+	}
+	FBMShotRecord& shot = pendingShots.AddDefaulted_GetRef();
+	shot.origin = origin;
+	shot.direction = direction;
+	shot.shotId = lastShotId;
+	shot.timeOffset = (uint16)FMath::Clamp(FMath::RoundToInt((now - pendingShotsBaseTime) * 1000.0f), 0, (int32)MAX_uint16);
+
+	// single shots go right away, automatic fire waits for the batch
+	if (!bWantsToFire || !bAutomaticFire || pendingShots.Num() >= maxShotsPerBatch) {
+		FlushShots();
+	}
+}
+
+void ABMShooterCharacter::PlayFireCosmetics(const FVector& origin, const FVector& direction) {
+	if (IsNetMode(NM_DedicatedServer)) {
+		return;
+	}
+
+	// null until streamed in, the first shots after spawning may go without them
+	USoundBase* fireSound = FireSound.Get();
+	if (fireSound != NULL) {
+		UGameplayStatics::PlaySoundAtLocation(this, fireSound, origin);
+	}
+
+	UAnimMontage* fireAnimation = FPFireAnimation.Get();
+	if (fireAnimation != NULL && FPMesh) {
+		UAnimInstance* animInstance = FPMesh->GetAnimInstance();
+		if (animInstance != NULL) {
+			animInstance->Montage_Play(fireAnimation, 1.0f);
+		}
+	}
+
+	FVector end = origin + direction * hitscanRange;
+	if (fireMode == EBMFireMode::Hitscan) {
+		// local trace only for the cosmetics, the server decides what was hit
+		FHitResult hit;
+		FCollisionQueryParams queryParams(SCENE_QUERY_STAT(ShotCosmetics), true, this);
+		if (GetWorld()->LineTraceSingleByChannel(hit, origin, end, ECC_Visibility, queryParams)) {
+			end = hit.ImpactPoint;
+		}
+	}
+	ShotFired(origin, end);
+}
+
+void ABMShooterCharacter::UpdateFiring() {
+	bool bHoldingFire = bWantsToFire;
+#if !UE_BUILD_SHIPPING
+	bHoldingFire |= CVarPredictionAutoFire.GetValueOnGameThread() > 0 && IsPlayerControlled();
+#endif
+
+	if (bHoldingFire && bAutomaticFire) {
+		OnFire();
+	}
+
+	if (pendingShots.Num() > 0 && GetServerTime() - pendingShotsBaseTime >= shotBatchInterval) {
+		FlushShots();
+	}
+}
+
+void ABMShooterCharacter::FlushShots() {
+	if (pendingShots.Num() == 0) {
+		return;
+	}
+
+	ServerFireShots(pendingShotsBaseTime, pendingShots);
+	pendingShots.Reset();
+}
+
+void ABMShooterCharacter::ServerFireShots_Implementation(float baseTime, const TArray<FBMShotRecord>& shots) {
+	BM_SCOPE_CYCLE_COUNTER(STAT_ServerFireShots);
+	BM_COUNT_CALL(STAT_ServerFireShotsCalls);
+	UBMLoadTestRecorder::CountRPC();
+
+	TArray<uint16> rejectedShots;
+	for (int32 i = 0; i < shots.Num(); i++) {
+		const FBMShotRecord& shot = shots[i];
+		const float fireTime = baseTime + shot.timeOffset / 1000.0f;
+		if (i >= maxShotsPerBatch || !ValidateShot(fireTime)) {
+			BM_COUNT_CALL(STAT_ShotsRejected);
+			rejectedShots.Add(shot.shotId);
+			continue;
+		}
+
+		ProcessShot(shot.origin, shot.direction.GetSafeNormal(), fireTime, shot.shotId);
+	}
+
+	if (rejectedShots.Num() > 0) {
+		ClientRejectShots(rejectedShots);
+	}
+}
+
+bool ABMShooterCharacter::ValidateShot(float fireTime) {
+	const float now = GetWorld()->GetTimeSeconds();
+	if (characterDead || ammo <= 0 || fireRate <= 0.0f) {
+		return false;
+	}
+
+	// shot times only move forward, never faster than the fire rate and never ahead of the server or older than the
+	// rewind window, with a little slack for the client's estimate of the server clock
+	const ULagCompensationSubsystem* lagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+	const float oldestFireTime = now - (lagCompensation ? lagCompensation->maxRewindTime : 0.0f) - 0.1f;
+	if (fireTime < oldestFireTime || fireTime > now + 0.1f) {
+		return false;
+	}
+
+	// a long pause doesn't bank shots, backdated ones can't fit more than the fire rate into the window
+	const float minInterval = 0.9f / fireRate;
+	lastServerShotTime = FMath::Max(lastServerShotTime, oldestFireTime - minInterval);
+	if (fireTime - lastServerShotTime < minInterval) {
+		return false;
+	}
+
+	lastServerShotTime = fireTime;
+	ammo--;
+	if (ammo <= 0) {
+		reloadEndTime = now + reloadTime;
+	}
+	return true;
+}
+
+void ABMShooterCharacter::ProcessShot(const FVector& origin, const FVector& direction, float fireTime, uint16 shotId) {
+	// don't trust an origin too far from where the server has the character
+	FVector eyeLocation;
+	FRotator eyeRotation;
+	GetActorEyesViewPoint(eyeLocation, eyeRotation);
+	const FVector shotOrigin = FVector::DistSquared(origin, eyeLocation) > FMath::Square(shotMaxOriginError) ? eyeLocation : origin;
+
+	if (fireMode == EBMFireMode::Hitscan) {
+		ULagCompensationSubsystem* lagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+		FHitResult hit;
+		float shotLength = hitscanRange;
+		if (lagCompensation && lagCompensation->RewindLineTrace(shotOrigin, shotOrigin + direction * hitscanRange, fireTime, this, hit)) {
+			UCombatEventSubsystem::ApplyHit(GetWorld(), hit.GetActor(), hitscanDamage, GetController(), this);
+			UCosmeticEventSubsystem::QueueEvent(GetWorld(), EBMCosmeticType::Impact, hit.ImpactPoint, hit.ImpactNormal, this);
+			shotLength = FVector::Dist(shotOrigin, hit.ImpactPoint);
+		}
+		UCosmeticEventSubsystem::QueueEvent(GetWorld(), EBMCosmeticType::Fire, shotOrigin, direction, this, shotLength);
+		return;
+	}
+
+	UCosmeticEventSubsystem::QueueEvent(GetWorld(), EBMCosmeticType::Fire, shotOrigin, direction, this);
+
+	ABMShooterShotStream::CountShot();
+
+	// streamed shots are flown by the simulation on every machine, the owner keeps its prediction
+	UProjectileSimulationSubsystem* simulation = GetWorld()->GetSubsystem<UProjectileSimulationSubsystem>();
+	ABMShooterShotStream* shotStream = (simulation && ABMShooterShotStream::IsEnabled()) ? simulation->GetShotStream() : nullptr;
+	if (shotStream) {
+		shotStream->FireShot(ProjectileClass, shotOrigin, direction, this, shotId);
+		return;
+	}
+
+	const FTransform spawnTransform(direction.Rotation(), shotOrigin);
+	UProjectilePoolSubsystem* projectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>();
+	if (projectilePool) {
+		ABMShooterProjectile* projectile = projectilePool->AcquireProjectile(ProjectileClass, spawnTransform, this, this);
+		if (projectile) {
+			projectile->SetShotId(shotId);
+		}
+	}
+	else {
+		BM_LLM_SCOPE(Projectiles);
+
+		FActorSpawnParameters spawnParams;
+		spawnParams.Owner = this;
+		spawnParams.Instigator = this;
+		spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
+		GetWorld()->SpawnActor<ABMShooterProjectile>(ProjectileClass, spawnTransform, spawnParams);
+	}
+}
+
+void ABMShooterCharacter::SpawnPredictedProjectile(uint16 shotId, const FVector& origin, const FVector& direction) {
+	const float now = GetWorld()->GetTimeSeconds();
+
+	// the server answers within a round trip, anything older was lost with its projectile
+	for (auto it = predictedShots.CreateIterator(); it; ++it) {
+		if (now - it.Value().spawnTime > 1.0f) {
+			it.RemoveCurrent();
+		}
+	}
+
+	BM_LLM_SCOPE(Projectiles);
+
+	FActorSpawnParameters spawnParams;
+	spawnParams.Owner = this;
+	spawnParams.Instigator = this;
+	spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	ABMShooterProjectile* projectile = GetWorld()->SpawnActor<ABMShooterProjectile>(ProjectileClass, origin, direction.Rotation(), spawnParams);
+	if (!projectile) {
+		return;
+	}
+	projectile->InitPrediction(shotId);
+
+	FBMPredictedShot& prediction = predictedShots.Add(shotId);
+	prediction.projectile = projectile;
+	prediction.origin = origin;
+	prediction.direction = direction;
+	prediction.spawnTime = now;
+}
+
+void ABMShooterCharacter::ReconcilePredictedProjectile(ABMShooterProjectile* serverProjectile) {
+	if (!serverProjectile) {
+		return;
+	}
+
+	const FBMProjectileLaunch& launch = serverProjectile->GetLaunch();
+	bool bMerge = false;
+	ABMShooterProjectile* predicted = TakePrediction(launch.shotId, launch.origin, launch.direction, serverProjectile->GetProjectileMovement()->InitialSpeed, bMerge);
+	if (!predicted) {
+		// the prediction expired, the server projectile shows as it is
+		return;
+	}
+
+	if (bMerge) {
+		if (predicted->HasPredictedImpact()) {
+			// this client already saw it hit, don't show it a second time
+			serverProjectile->Release();
+		}
+		else {
+			serverProjectile->MergePrediction(predicted);
+		}
+	}
+	predicted->Destroy();
+}
+
+ABMShooterProjectile* ABMShooterCharacter::ReconcileStreamedShot(uint16 shotId, const FVector& origin, const FVector& direction, float initialSpeed) {
+	bool bMerge = false;
+	ABMShooterProjectile* predicted = TakePrediction(shotId, origin, direction, initialSpeed, bMerge);
+	if (!predicted || bMerge) {
+		// a streamed shot has no actor to hand the flight to, a close enough prediction just goes on as the shot
+		return predicted;
+	}
+
+	predicted->Destroy();
+	return nullptr;
+}
+
+ABMShooterProjectile* ABMShooterCharacter::TakePrediction(uint16 shotId, const FVector& origin, const FVector& direction, float initialSpeed, bool& bOutMerge) {
+	bOutMerge = false;
+	FBMPredictedShot prediction;
+	if (shotId == 0 || !predictedShots.RemoveAndCopyValue(shotId, prediction)) {
+		return nullptr;
+	}
+
+	ABMShooterProjectile* predicted = prediction.projectile.Get();
+	if (!predicted) {
+		return nullptr;
+	}
+
+	// both flights share gravity and speed, so the gap between the two straight launches is the visible error
+	const float flightDistance = initialSpeed * (GetWorld()->GetTimeSeconds() - prediction.spawnTime);
+	const FVector serverPosition = origin + direction * flightDistance;
+	const FVector predictedPosition = prediction.origin + prediction.direction * flightDistance;
+	const float divergence = FVector::Dist(serverPosition, predictedPosition);
+
+	bOutMerge = divergence <= predictionMergeTolerance;
+	if (bOutMerge) {
+		BM_COUNT_CALL(STAT_PredictionsMerged);
+	}
+	else {
+		BM_COUNT_CALL(STAT_PredictionsReplaced);
+	}
+
+	SET_FLOAT_STAT(STAT_PredictionDivergence, divergence);
+	CSV_CUSTOM_STAT(BMShooter, PredictionDivergence, divergence, ECsvCustomStatOp::Max);
+
+#if !UE_BUILD_SHIPPING
+	(bOutMerge ? GPredictionStats.numMerged : GPredictionStats.numReplaced)++;
+	GPredictionStats.totalDivergence += divergence;
+	GPredictionStats.maxDivergence = FMath::Max(GPredictionStats.maxDivergence, divergence);
+	if (CVarPredictionLog.GetValueOnGameThread() > 0) {
+		UE_LOG(LogFPChar, Warning, TEXT("Shot %d %s, divergence %.1f"), shotId, bOutMerge ? TEXT("merged") : TEXT("replaced"), divergence);
+	}
+#endif
+
+	return predicted;
+}
+
+void ABMShooterCharacter::ClientRejectShots_Implementation(const TArray<uint16>& shotIds) {
+	for (uint16 shotId : shotIds) {
+		FBMPredictedShot prediction;
+		if (predictedShots.RemoveAndCopyValue(shotId, prediction) && prediction.projectile.IsValid()) {
+			prediction.projectile->Destroy();
+		}
+
+		BM_COUNT_CALL(STAT_PredictionsRejected);
+#if !UE_BUILD_SHIPPING
+		GPredictionStats.numRejected++;
+#endif
+	}
+}
+
+void ABMShooterCharacter::UpdateReload(float now) {
+	if (ammo <= 0 && now >= reloadEndTime) {
+		ammo = magazineSize;
 	}
 }
 
@@ -158,9 +678,31 @@ void ABMShooterCharacter::LookUpAtRate(float Rate)
 {
 	// calculate delta for this frame from the rate information
 	AddControllerPitchInput(Rate * BaseLookUpRate * GetWorld()->GetDeltaSeconds());
+}
 
-	FRotator rotation = FirstPersonCameraComponent->GetComponentRotation();
-	CorrectPitchServer(rotation);
+void ABMShooterCharacter::Tick(float DeltaSeconds) {
+	Super::Tick(DeltaSeconds);
+
+	if (GetLocalRole() == ROLE_Authority) {
+		UpdateReplicatedAim();
+	}
+	else if (GetLocalRole() == ROLE_SimulatedProxy) {
+		correctedRotation = FMath::RInterpTo(correctedRotation, replicatedAim.ToRotator(), DeltaSeconds, aimInterpSpeed).GetNormalized();
+	}
+	else {
+		// the owning client already has the exact aim
+		correctedRotation = GetControlRotation().GetNormalized();
+	}
+
+	if (IsLocallyControlled()) {
+		UpdateFiring();
+	}
+	if (GetLocalRole() == ROLE_Authority) {
+		UpdateReload(GetWorld()->GetTimeSeconds());
+	}
+	else if (IsLocallyControlled()) {
+		UpdateReload(GetServerTime());
+	}
 }
 
 void ABMShooterCharacter::OnRep_CharacterDead()
@@ -169,6 +711,7 @@ void ABMShooterCharacter::OnRep_CharacterDead()
 	{
 		
 		ActivateRagdoll();
+		PlayKillCam();
 	}
 	else
 	{
@@ -182,77 +725,165 @@ void ABMShooterCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>&
 
 	//Replicate current health.
 	DOREPLIFETIME(ABMShooterCharacter, characterDead);
+
+	// only the victim's kill cam needs it
+	DOREPLIFETIME_CONDITION(ABMShooterCharacter, killer, COND_OwnerOnly);
+
+	// the owner drives its own aim
+	DOREPLIFETIME_CONDITION(ABMShooterCharacter, replicatedAim, COND_SkipOwner);
+
+	// only the owner shows its ammo
+	DOREPLIFETIME_CONDITION(ABMShooterCharacter, ammo, COND_OwnerOnly);
 }
 
 void ABMShooterCharacter::RespawnCharacter() {
+	BM_SCOPE_CYCLE_COUNTER(STAT_RespawnCharacter);
+	BM_COUNT_CALL(STAT_RespawnCharacterCalls);
+
 	// spawn on server
 	if (GetLocalRole() == ROLE_Authority) {
-		UNavigationSystemV1* navigationSystem = UNavigationSystemV1::GetCurrent(GetWorld());
-		FNavLocation navLocation;
-		
-		navigationSystem->GetRandomPoint(navLocation); // get random point on nav mesh
-		SetActorLocation(navLocation);
-		SetActorLocation(GetActorLocation() + FVector(0.0f, 0.0f, 180.0f)); // it appeared on the floor otherwise
-		
+		USpawnPointSubsystem* spawnPoints = GetWorld()->GetSubsystem<USpawnPointSubsystem>();
+		FVector spawnLocation;
+		if (spawnPoints && spawnPoints->PickSpawnPoint(this, spawnLocation)) {
+			// spawn points are on the floor, the capsule is centered on the actor
+			spawnLocation.Z += GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+			SetActorLocation(spawnLocation, false, nullptr, ETeleportType::TeleportPhysics);
+		}
+		else {
+			UE_LOG(LogFPChar, Warning, TEXT("%s found no spawn point, respawning in place"), *GetName());
+		}
+
 		healthComponent->ResetHealth();
+		ammo = magazineSize;
 		characterDead = false;
+		killer = nullptr;
+		UBMShooterReplicationGraph::NotifyCharacterDead(this, false);
 	}
 }
 
 void ABMShooterCharacter::ActivateRagdoll() {
-	GetMesh()->SetSimulatePhysics(true);
-	GetMesh()->SetCollisionProfileName("Ragdoll");
+	BM_SCOPE_CYCLE_COUNTER(STAT_ActivateRagdoll);
+	BM_COUNT_CALL(STAT_ActivateRagdollCalls);
+
+	// the budget decides if the body simulates, it is frozen in the pose it died in otherwise
+	URagdollBudgetSubsystem* ragdolls = GetWorld()->GetSubsystem<URagdollBudgetSubsystem>();
+	if (ragdolls) {
+		ragdolls->RequestRagdoll(GetMesh());
+	}
 
 	if (IsLocallyControlled()) {
-		// hide fp meshes and show tp meshes
-		FPMesh->SetOwnerNoSee(true);
-		FPGun->SetOwnerNoSee(true);
+		// hide fp meshes and show tp meshes, bots on a dedicated server have none of them
+		if (FPMesh) {
+			FPMesh->SetOwnerNoSee(true);
+		}
+		if (FPGun) {
+			FPGun->SetOwnerNoSee(true);
+		}
 		GetMesh()->SetOwnerNoSee(false);
-		TPGun->SetOwnerNoSee(false);
+		if (TPGun) {
+			TPGun->SetOwnerNoSee(false);
+		}
 		
 		// disable input
 		DisableInput(Cast<APlayerController>(GetController()));
 
 		// to see the ragdoll when dead
-		FirstPersonCameraComponent->bUsePawnControlRotation = false;
-		FirstPersonCameraComponent->SetRelativeRotation(FRotator(-90.0f, 0.0f, 0.0f));
+		if (FirstPersonCameraComponent) {
+			FirstPersonCameraComponent->bUsePawnControlRotation = false;
+			FirstPersonCameraComponent->SetRelativeRotation(FRotator(-90.0f, 0.0f, 0.0f));
+		}
 	}
 }
 
 void ABMShooterCharacter::ResetCharacter() {
+	BM_SCOPE_CYCLE_COUNTER(STAT_ResetCharacter);
+	BM_COUNT_CALL(STAT_ResetCharacterCalls);
+
+	if (IsLocallyControlled()) {
+		UReplayBufferSubsystem* replayBuffer = GetWorld()->GetSubsystem<UReplayBufferSubsystem>();
+		if (replayBuffer) {
+			replayBuffer->StopKillCam();
+		}
+	}
+
+	URagdollBudgetSubsystem* ragdolls = GetWorld()->GetSubsystem<URagdollBudgetSubsystem>();
+	if (ragdolls) {
+		ragdolls->ReleaseRagdoll(GetMesh());
+	}
+	else {
+		GetMesh()->SetSimulatePhysics(false);
+	}
+
 	GetMesh()->AttachTo(GetCapsuleComponent(), NAME_None, EAttachLocation::SnapToTarget, true);
-	GetMesh()->SetSimulatePhysics(false);
 	GetMesh()->SetCollisionProfileName("CharacterMesh");
 
 	if (IsLocallyControlled()) {
 		// hide tp meshes and show fp meshes
 		GetMesh()->SetOwnerNoSee(true);
-		TPGun->SetOwnerNoSee(true);
-		FPMesh->SetOwnerNoSee(false);
-		FPGun->SetOwnerNoSee(false);
+		if (TPGun) {
+			TPGun->SetOwnerNoSee(true);
+		}
+		if (FPMesh) {
+			FPMesh->SetOwnerNoSee(false);
+		}
+		if (FPGun) {
+			FPGun->SetOwnerNoSee(false);
+		}
 
 		// enable input 
 		EnableInput(Cast<APlayerController>(GetController()));
 
 		//reset camera values
-		
-		FirstPersonCameraComponent->SetRelativeRotation(FRotator(90.0f, 0.0f, 0.0f));
-		FirstPersonCameraComponent->bUsePawnControlRotation = true;
+		if (FirstPersonCameraComponent) {
+			FirstPersonCameraComponent->SetRelativeRotation(FRotator(90.0f, 0.0f, 0.0f));
+			FirstPersonCameraComponent->bUsePawnControlRotation = true;
+		}
+	}
+}
+
+void ABMShooterCharacter::DisableCosmeticComponents() {
+	// only reached in builds that still create them, a dedicated server target never does
+	USceneComponent* cosmetics[] = { FirstPersonCameraComponent, FPMesh, FPGun, FPMuzzleLocation, TPGun };
+	for (USceneComponent* component : cosmetics) {
+		if (component) {
+			component->SetComponentTickEnabled(false);
+			component->SetVisibility(false);
+		}
+	}
+}
+
+void ABMShooterCharacter::LoadCosmeticAssets() {
+	TArray<FSoftObjectPath> assets;
+	const FSoftObjectPath paths[] = { FireSound.ToSoftObjectPath(), FPFireAnimation.ToSoftObjectPath(), TPFireAnimation.ToSoftObjectPath() };
+	for (const FSoftObjectPath& path : paths) {
+		if (!path.IsNull()) {
+			assets.AddUnique(path);
+		}
+	}
+
+	// every character shares the same assets, after the first one this finds them loaded and completes right away
+	if (assets.Num() > 0) {
+		BM_LLM_SCOPE(Cosmetics);
+		cosmeticAssetsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(assets, FStreamableDelegate(), FStreamableManager::AsyncLoadHighPriority);
 	}
 }
 
+UAnimMontage* ABMShooterCharacter::GetTPFireAnimation() const {
+	return TPFireAnimation.Get();
+}
+
 void ABMShooterCharacter::HealthModified() {
+	BM_SCOPE_CYCLE_COUNTER(STAT_HealthModified);
+	BM_COUNT_CALL(STAT_HealthModifiedCalls);
+
 	if (GetLocalRole() == ROLE_Authority) {
 
-		// check on server if the character is dead
-		if (healthComponent->GetCurrentHealth() == 0 && !characterDead) {
-			characterDead = true;
-			FString text = "should respawn";
-			GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Blue, text);
-			// Respawn character using unreal timer
-			FTimerHandle respawnTimer;
-			GetWorldTimerManager().SetTimer<ABMShooterCharacter>(respawnTimer, this, 
-				&ABMShooterCharacter::RespawnCharacter, respawnTime, false);
+		// check on server if the character is dead, the combat queue kills it once all the hits of this tick are applied
+		if (BMCombat::ShouldDie(healthComponent->GetCurrentHealth(), characterDead)) {
+			UCombatEventSubsystem* combatEvents = GetWorld()->GetSubsystem<UCombatEventSubsystem>();
+			if (combatEvents) {
+				combatEvents->QueueDeath(this);
+			}
 		}
 	}
 
@@ -264,10 +895,106 @@ void ABMShooterCharacter::HealthModified() {
 	} */
 }
 
-void ABMShooterCharacter::CorrectPitchServer_Implementation(FRotator rotation) {
-	CorrectPitchMulticast(rotation);
+void ABMShooterCharacter::Die() {
+	characterDead = true;
+	UBMShooterReplicationGraph::NotifyCharacterDead(this, true);
+
+	// poison or regen don't carry over to the next life
+	UHealthEffectSubsystem* healthEffects = GetWorld()->GetSubsystem<UHealthEffectSubsystem>();
+	if (healthEffects) {
+		healthEffects->RemoveEffects(healthComponent);
+	}
+
+	// a listen server host gets no rep notify for its own death
+	PlayKillCam();
 }
 
-void ABMShooterCharacter::CorrectPitchMulticast_Implementation(FRotator rotation) {
-	correctedRotation = rotation;
-}
\ No newline at end of file
+void ABMShooterCharacter::PlayKillCam() {
+	// bots are locally controlled on the server too, the replay buffer only plays it for a local player
+	if (!IsLocallyControlled() || !killer) {
+		return;
+	}
+
+	UReplayBufferSubsystem* replayBuffer = GetWorld()->GetSubsystem<UReplayBufferSubsystem>();
+	if (replayBuffer) {
+		replayBuffer->StartKillCam(this, killer);
+	}
+}
+
+void ABMShooterCharacter::UpdateReplicatedAim() {
+	BM_SCOPE_CYCLE_COUNTER(STAT_UpdateReplicatedAim);
+
+	// the server already gets the view rotation with every move, no need for an extra RPC
+	if (!GetController() || characterDead) {
+		return;
+	}
+
+	correctedRotation = GetControlRotation().GetNormalized();
+
+	const float now = GetWorld()->GetTimeSeconds();
+	if (now - lastAimReplicationTime < 1.0f / FMath::Max(aimReplicationRate, 1.0f)) {
+		return;
+	}
+
+	const FRotator replicatedRotation = replicatedAim.ToRotator();
+	const float pitchDelta = FMath::Abs(FRotator::NormalizeAxis(correctedRotation.Pitch - replicatedRotation.Pitch));
+	const float yawDelta = FMath::Abs(FRotator::NormalizeAxis(correctedRotation.Yaw - replicatedRotation.Yaw));
+	if (pitchDelta < aimReplicationThreshold && yawDelta < aimReplicationThreshold) {
+		return;
+	}
+
+	replicatedAim = FBMRepAim(correctedRotation);
+	lastAimReplicationTime = now;
+	BM_COUNT_CALL(STAT_AimUpdatesSent);
+}
+
+void ABMShooterCharacter::OnRep_ReplicatedAim() {
+	BM_COUNT_CALL(STAT_AimUpdatesReceived);
+
+	// snap on the first update, Tick interpolates the following ones
+	if (correctedRotation.IsZero()) {
+		correctedRotation = replicatedAim.ToRotator();
+	}
+}
+#if !UE_BUILD_SHIPPING
+DEFINE_LOG_CATEGORY_STATIC(LogBMFootprint, Log, All);
+
+// Logs the components, ticking components and exclusive memory of every character, to compare a dedicated server with a client
+static FAutoConsoleCommandWithWorldAndArgs CharacterFootprintCommand(
+	TEXT("bm.CharacterFootprint"),
+	TEXT("bm.CharacterFootprint: logs the component count, ticking components and memory of each character"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& args, UWorld* world) {
+		if (!world) {
+			return;
+		}
+
+		int32 numCharacters = 0;
+		int32 totalComponents = 0;
+		int32 totalTicking = 0;
+		SIZE_T totalBytes = 0;
+		for (TActorIterator<ABMShooterCharacter> it(world); it; ++it) {
+			ABMShooterCharacter* character = *it;
+
+			int32 numTicking = character->IsActorTickEnabled() ? 1 : 0;
+			SIZE_T bytes = character->GetClass()->GetStructureSize() + character->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+			TInlineComponentArray<UActorComponent*> components(character);
+			for (UActorComponent* component : components) {
+				numTicking += component->IsComponentTickEnabled() ? 1 : 0;
+				bytes += component->GetClass()->GetStructureSize() + component->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+			}
+
+			const bool bPosesEveryFrame = character->GetMesh()->VisibilityBasedAnimTickOption != EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered;
+			UE_LOG(LogBMFootprint, Log, TEXT("%s: %d components, %d ticking, %.1f KB, pose every frame %d"),
+				*character->GetName(), components.Num(), numTicking, bytes / 1024.0f, bPosesEveryFrame ? 1 : 0);
+
+			numCharacters++;
+			totalComponents += components.Num();
+			totalTicking += numTicking;
+			totalBytes += bytes;
+		}
+
+		UE_LOG(LogBMFootprint, Log, TEXT("%d characters (%s): %d components, %d ticking, %.1f KB"),
+			numCharacters, world->IsNetMode(NM_DedicatedServer) ? TEXT("dedicated server") : TEXT("client"), totalComponents, totalTicking, totalBytes / 1024.0f);
+	})
+);
+#endif
@@ -4,18 +4,101 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "Engine/NetSerialization.h"
+#include "Engine/StreamableManager.h"
 #include "BMShooterCharacter.generated.h"
 
 class UInputComponent;
 
+// Aim replicated to the other clients, pitch and yaw quantized to 16 bits each
+USTRUCT()
+struct FBMRepAim
+{
+	GENERATED_BODY()
+
+	uint16 pitch = 0;
+	uint16 yaw = 0;
+
+	FBMRepAim() {}
+
+	explicit FBMRepAim(const FRotator& rotation)
+		: pitch(FRotator::CompressAxisToShort(rotation.Pitch))
+		, yaw(FRotator::CompressAxisToShort(rotation.Yaw)) {}
+
+	FORCEINLINE FRotator ToRotator() const {
+		return FRotator(FRotator::DecompressAxisFromShort(pitch), FRotator::DecompressAxisFromShort(yaw), 0.0f).GetNormalized();
+	}
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess) {
+		Ar << pitch;
+		Ar << yaw;
+		bOutSuccess = true;
+		return true;
+	}
+
+	FORCEINLINE bool operator==(const FBMRepAim& other) const { return pitch == other.pitch && yaw == other.yaw; }
+	FORCEINLINE bool operator!=(const FBMRepAim& other) const { return !(*this == other); }
+};
+
+template<>
+struct TStructOpsTypeTraits<FBMRepAim> : public TStructOpsTypeTraitsBase2<FBMRepAim>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
+// A shot sent to the server, timeOffset is in milliseconds from the time of its batch
+USTRUCT()
+struct FBMShotRecord
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize origin;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal direction;
+
+	UPROPERTY()
+	uint16 timeOffset = 0;
+
+	// numbered by the firing client so predictions can be matched or rejected, never 0
+	UPROPERTY()
+	uint16 shotId = 0;
+};
+
+// A projectile the owning client spawned before the server confirmed the shot
+struct FBMPredictedShot
+{
+	TWeakObjectPtr<class ABMShooterProjectile> projectile;
+	FVector origin = FVector::ZeroVector;
+	FVector direction = FVector::ForwardVector;
+	float spawnTime = 0.0f;
+};
+
+UENUM(BlueprintType)
+enum class EBMFireMode : uint8
+{
+	// physical projectiles taken from the pool
+	Projectile,
+	// instant traces validated on the server against rewound hitboxes
+	Hitscan
+};
+
 UCLASS(config=Game)
 class ABMShooterCharacter : public ACharacter
 {
 	GENERATED_BODY()
 
+	friend class UCombatEventSubsystem;
+	friend class ABMShooterBotController;
+	friend class UCosmeticFXSubsystem;
 
 public: // Public functions
-	ABMShooterCharacter();
+	ABMShooterCharacter(const FObjectInitializer& ObjectInitializer);
 
 	/** Returns Mesh1P subobject **/
 	FORCEINLINE class USkeletalMeshComponent* GetMesh1P() const { return FPMesh; }
@@ -26,16 +109,81 @@ public: // Public functions
 	// Property replication
 	void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** Owning client: matches a projectile launched by the server with the prediction of the same shot */
+	void ReconcilePredictedProjectile(class ABMShooterProjectile* serverProjectile);
+
+	/**
+	 * Owning client: matches a streamed shot with the prediction of the same shot.
+	 * @return the prediction if it is close enough to keep flying as the shot, the caller ends it with the server shot
+	 */
+	class ABMShooterProjectile* ReconcileStreamedShot(uint16 shotId, const FVector& origin, const FVector& direction, float initialSpeed);
+
 protected:
 
 	virtual void BeginPlay();
 
-	/** Fires a projectile. */
+	/** Fires one shot if the weapon is ready. Cosmetics are predicted, the shot is queued for the server */
 	void OnFire();
 
+	/** Fire input pressed, automatic weapons keep firing from Tick while it is held */
+	void StartFire();
+
+	/** Fire input released, sends the shots still waiting for their batch */
+	void StopFire();
+
+	bool CanFire(float now) const;
+
+	/** Server time the client sees, the world time on the server */
+	float GetServerTime() const;
+
+	/** Where a shot fired now starts and where it goes */
+	void GetShotOriginAndDirection(FVector& outOrigin, FVector& outDirection) const;
 
+	/** Muzzle sound, first person animation and the ShotFired event, on the firing client */
+	void PlayFireCosmetics(const FVector& origin, const FVector& direction);
+
+	/** Cosmetics for a shot on the owning client, end is where the local trace stopped for hitscan shots */
+	UFUNCTION(BlueprintImplementableEvent)
+	void ShotFired(FVector start, FVector end);
+
+	/** Cosmetics for a shot of this character on other clients, from the batch of cosmetic events */
 	UFUNCTION(BlueprintImplementableEvent)
-	void Fire();
+	void RemoteShotFired(FVector start, FVector end);
+
+	/** Automatic fire and batch flushing on the firing machine */
+	void UpdateFiring();
+
+	/** Sends the queued shots in a single RPC */
+	void FlushShots();
+
+	/** Validates and fires a batch of shots, their times are offsets from baseTime */
+	UFUNCTION(Server, Reliable)
+	void ServerFireShots(float baseTime, const TArray<FBMShotRecord>& shots);
+
+	/** Server: checks the fire rate and ammo of a shot and consumes a round */
+	bool ValidateShot(float fireTime);
+
+	/** Server: traces the shot against rewound hitboxes or launches its projectile */
+	void ProcessShot(const FVector& origin, const FVector& direction, float fireTime, uint16 shotId);
+
+	/** Owning client: spawns a local projectile for the shot until the server's one arrives */
+	void SpawnPredictedProjectile(uint16 shotId, const FVector& origin, const FVector& direction);
+
+	/**
+	 * Owning client: takes the prediction of a shot the server launched and counts how far apart both are.
+	 * @param bOutMerge	true if the prediction is close enough for the server shot to continue it
+	 * @return null if the shot was not predicted or its prediction is gone
+	 */
+	class ABMShooterProjectile* TakePrediction(uint16 shotId, const FVector& origin, const FVector& direction, float initialSpeed, bool& bOutMerge);
+
+	/** Drops the predictions of shots the server did not fire */
+	UFUNCTION(Client, Reliable)
+	void ClientRejectShots(const TArray<uint16>& shotIds);
+
+	/** Refills the magazine once the reload is over, on the server and predicted on the owner */
+	void UpdateReload(float now);
 
 	/** Handles moving forward/backward */
 	void MoveForward(float Val);
@@ -65,48 +213,64 @@ protected:
 
 	void RespawnCharacter();
 
+	// Server: marks the character dead, called from the combat death pass
+	void Die();
+
 	void ActivateRagdoll();
 
+	/** Victim's machine: replays the killer's view of the last seconds before the death */
+	void PlayKillCam();
+
 	void ResetCharacter();
 
+	/** Dedicated server: stops ticking the first person and cosmetic components in builds that create them */
+	void DisableCosmeticComponents();
+
+	/** Clients: streams in the fire sound and montages, a dedicated server never loads them */
+	void LoadCosmeticAssets();
+
+	TSharedPtr<FStreamableHandle> cosmeticAssetsHandle;
+
 	UFUNCTION()
 	void HealthModified();
 
-	UFUNCTION(Server, Unreliable)
-	void CorrectPitchServer(FRotator rotation);
+	/** Server: copies the controller aim to replicatedAim when it moved enough and the rate allows it */
+	void UpdateReplicatedAim();
 
-	UFUNCTION(NetMultiCast, Unreliable)
-		void CorrectPitchMulticast(FRotator rotation);
+	UFUNCTION()
+	void OnRep_ReplicatedAim();
 
 public: // Public variables
 
+	// The first person and cosmetic components below are not created in dedicated server builds, check them before use
+
 	/** Pawn mesh: 1st person view (arms; seen only by self) */
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly, Category = Mesh)
-		class USkeletalMeshComponent* FPMesh;
+		class USkeletalMeshComponent* FPMesh = nullptr;
 
 	/** Gun mesh: 1st person view (seen only by self) */
 	UPROPERTY(VisibleDefaultsOnly, Category = Mesh)
-		class USkeletalMeshComponent* FPGun;
+		class USkeletalMeshComponent* FPGun = nullptr;
 
 	/** Location on gun mesh where projectiles should spawn. (first person)*/
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly, Category = Mesh)
-		class USceneComponent* FPMuzzleLocation;
+		class USceneComponent* FPMuzzleLocation = nullptr;
 
-	/** AnimMontage to play each time we fire (first person) */
+	/** AnimMontage to play each time we fire (first person), streamed in on clients only */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gameplay)
-		class UAnimMontage* FPFireAnimation;
+		TSoftObjectPtr<class UAnimMontage> FPFireAnimation;
 
 	/** First person camera */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
-		class UCameraComponent* FirstPersonCameraComponent;
+		class UCameraComponent* FirstPersonCameraComponent = nullptr;
 
 	/** Gun mesh: 3rd person view (seen by others) */
 	UPROPERTY(VisibleDefaultsOnly, Category = Mesh)
-		class USkeletalMeshComponent* TPGun;
+		class USkeletalMeshComponent* TPGun = nullptr;
 
-	/** AnimMontage to play each time we fire seen by others*/
+	/** AnimMontage to play each time we fire seen by others, streamed in on clients only */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gameplay)
-		class UAnimMontage* TPFireAnimation;
+		TSoftObjectPtr<class UAnimMontage> TPFireAnimation;
 
 	/** Base turn rate, in deg/sec. Other scaling may affect final turn rate. */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera)
@@ -124,9 +288,74 @@ public: // Public variables
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Projectile)
 		TSubclassOf<class ABMShooterProjectile> ProjectileClass;
 
-	/** Sound to play each time we fire */
+	/** Whether the weapon fires projectiles or hitscan shots */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Gameplay)
+		EBMFireMode fireMode;
+
+	/** Damage of a hitscan shot */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Gameplay)
+		float hitscanDamage;
+
+	/** Max distance of a hitscan shot */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Gameplay)
+		float hitscanRange;
+
+	/** Max distance between the shot origin sent by the client and the server's eye location */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Gameplay)
+		float shotMaxOriginError;
+
+	/** Shots per second */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Gameplay)
+		float fireRate;
+
+	/** Keep firing while the fire input is held */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Gameplay)
+		bool bAutomaticFire;
+
+	/** Rounds in a full magazine */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Gameplay)
+		int32 magazineSize;
+
+	/** Seconds to refill an empty magazine */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Gameplay)
+		float reloadTime;
+
+	/** Rounds left, predicted on the owner and corrected by the server */
+	UPROPERTY(Replicated, BlueprintReadOnly, Category = Gameplay)
+		int32 ammo;
+
+	/** Seconds automatic fire collects shots before sending them in one RPC */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Replication)
+		float shotBatchInterval;
+
+	/** Max shots in one RPC, the server ignores the rest */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Replication)
+		int32 maxShotsPerBatch;
+
+	/** Spawn a local projectile as soon as the owning client fires, instead of waiting for the server's one */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Replication)
+		bool bPredictProjectiles;
+
+	/** Max distance between the prediction and the server projectile for the server one to take over smoothly */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Replication)
+		float predictionMergeTolerance;
+
+	/** Server history of the capsule, for lag compensated hits */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gameplay)
+		class UHitboxHistoryComponent* hitboxHistory;
+
+	/** Projectiles kept in the pool per player slot of the session, so the pool is warm for a full lobby */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Projectile)
+		int32 projectilePoolSize;
+
+	/** Sound to play each time we fire, streamed in on clients only */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gameplay)
-		class USoundBase* FireSound;
+		TSoftObjectPtr<class USoundBase> FireSound;
+
+	/** Third person fire montage once streamed in, null until then and on the dedicated server */
+	UFUNCTION(BlueprintPure, Category = Gameplay)
+		class UAnimMontage* GetTPFireAnimation() const;
+
 	// Health component
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = Health)
 		class UHealthComponent* healthComponent = nullptr;
@@ -136,8 +365,48 @@ public: // Public variables
 
 	UPROPERTY(ReplicatedUsing = OnRep_CharacterDead, BlueprintReadOnly)
 		bool characterDead;
+
+	/** Character that landed the killing hit, only replicated to the victim for its kill cam */
+	UPROPERTY(Replicated, BlueprintReadOnly)
+		ABMShooterCharacter* killer = nullptr;
 	
+	/** Aim of the character on every machine, interpolated from replicatedAim on simulated proxies */
 	UPROPERTY(BlueprintReadOnly)
 		FRotator correctedRotation;
+
+	/** Max aim updates per second sent to the other clients */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Replication)
+		float aimReplicationRate;
+
+	/** Degrees the aim has to move before it is sent again */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Replication)
+		float aimReplicationThreshold;
+
+	/** How fast simulated proxies catch up with the replicated aim */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Replication)
+		float aimInterpSpeed;
+
+protected:
+	UPROPERTY(ReplicatedUsing = OnRep_ReplicatedAim)
+		FBMRepAim replicatedAim;
+
+	float lastAimReplicationTime = 0.0f;
+
+	bool bWantsToFire = false;
+
+	// server time of the last shot fired, on the firing machine and on the server
+	float lastFireTime = -BIG_NUMBER;
+	float lastServerShotTime = -BIG_NUMBER;
+
+	float reloadEndTime = 0.0f;
+
+	// shots waiting to be sent, their offsets are from pendingShotsBaseTime
+	TArray<FBMShotRecord> pendingShots;
+	float pendingShotsBaseTime = 0.0f;
+
+	uint16 lastShotId = 0;
+
+	// predicted projectiles waiting for the server, by shot id
+	TMap<uint16, FBMPredictedShot> predictedShots;
 };
 
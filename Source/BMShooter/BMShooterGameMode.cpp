@@ -2,16 +2,116 @@
 
 #include "BMShooterGameMode.h"
 #include "BMShooterHUD.h"
+#include "BMShooterGameState.h"
+#include "BMShooterPlayerController.h"
 #include "BMShooterCharacter.h"
-#include "UObject/ConstructorHelpers.h"
+#include "Engine/AssetManager.h"
+#include "AI/BMShooterBotController.h"
+#include "LoadTest/BMLoadTestRecorder.h"
+#include "Subsystems/MemoryReportSubsystem.h"
+#include "BMShooterStats.h"
+#include "Engine/World.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "HAL/PlatformTime.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogBMGameMode, Log, All);
 
 ABMShooterGameMode::ABMShooterGameMode()
 	: Super()
 {
-	// set default pawn class to our Blueprinted character
-	static ConstructorHelpers::FClassFinder<APawn> PlayerPawnClassFinder(TEXT("/Game/FirstPersonCPP/Blueprints/FirstPersonCharacter"));
-	DefaultPawnClass = PlayerPawnClassFinder.Class;
+	// our Blueprinted character, only a path here so constructing the class default object loads nothing
+	characterClass = TSoftClassPtr<APawn>(FSoftObjectPath(TEXT("/Game/FirstPersonCPP/Blueprints/FirstPersonCharacter.FirstPersonCharacter_C")));
 
 	// use our custom HUD class
 	HUDClass = ABMShooterHUD::StaticClass();
+
+	// keeps the match stats table
+	GameStateClass = ABMShooterGameState::StaticClass();
+
+	// receives the batched cosmetics
+	PlayerControllerClass = ABMShooterPlayerController::StaticClass();
+}
+
+void ABMShooterGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) {
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	// loads alongside the rest of the map, the first spawn waits for it if it has not finished
+	if (!characterClass.IsNull()) {
+		BM_LLM_SCOPE(Characters);
+		characterClassHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(characterClass.ToSoftObjectPath(), FStreamableDelegate(), FStreamableManager::AsyncLoadHighPriority);
+	}
+}
+
+void ABMShooterGameMode::StartPlay() {
+	Super::StartPlay();
+
+	// read by Scripts/MeasureServerStartup.sh
+	if (IsNetMode(NM_DedicatedServer)) {
+		UE_LOG(LogBMGameMode, Log, TEXT("Server ready in %.2f s"), FPlatformTime::Seconds() - GStartTime);
+	}
+
+	StartLoadTest();
+}
+
+void ABMShooterGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason) {
+	if (loadTestRecorder) {
+		loadTestRecorder->StopRecording();
+	}
+
+	// memory per character and per projectile at the end of the match
+	UMemoryReportSubsystem* memoryReport = GetWorld()->GetSubsystem<UMemoryReportSubsystem>();
+	if (memoryReport) {
+		memoryReport->WriteReport(true);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+APawn* ABMShooterGameMode::SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform) {
+	// the Blueprint components of the character are created while spawning, after its constructor
+	BM_LLM_SCOPE(Characters);
+
+	return Super::SpawnDefaultPawnAtTransform_Implementation(NewPlayer, SpawnTransform);
+}
+
+UClass* ABMShooterGameMode::GetDefaultPawnClassForController_Implementation(AController* InController) {
+	if (!characterClass.IsNull()) {
+		if (characterClassHandle.IsValid() && characterClassHandle->IsLoadingInProgress()) {
+			characterClassHandle->WaitUntilComplete();
+		}
+
+		UClass* pawnClass = characterClass.LoadSynchronous();
+		if (pawnClass) {
+			return pawnClass;
+		}
+	}
+
+	return Super::GetDefaultPawnClassForController_Implementation(InController);
+}
+
+void ABMShooterGameMode::StartLoadTest() {
+	// e.g. BMShooterServer FirstPersonExampleMap -bmloadtest -bmbots=32 -bmloadtestduration=120
+	if (!FParse::Param(FCommandLine::Get(), TEXT("bmloadtest"))) {
+		return;
+	}
+
+	int32 numBots = 0;
+	FParse::Value(FCommandLine::Get(), TEXT("bmbots="), numBots);
+
+	float duration = 0.0f;
+	FParse::Value(FCommandLine::Get(), TEXT("bmloadtestduration="), duration);
+
+	UClass* controllerClass = botControllerClass ? *botControllerClass : ABMShooterBotController::StaticClass();
+	for (int32 i = 0; i < numBots; i++) {
+		FActorSpawnParameters spawnParams;
+		spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		AController* bot = GetWorld()->SpawnActor<AController>(controllerClass, spawnParams);
+		if (bot) {
+			RestartPlayer(bot);
+		}
+	}
+
+	loadTestRecorder = NewObject<UBMLoadTestRecorder>(this);
+	loadTestRecorder->StartRecording(GetWorld(), numBots, duration);
 }
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "Engine/StreamableManager.h"
 #include "BMShooterGameMode.generated.h"
 
 UCLASS(minimalapi)
@@ -13,6 +14,33 @@ class ABMShooterGameMode : public AGameModeBase
 
 public:
 	ABMShooterGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+
+	virtual void StartPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual APawn* SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform) override;
+
+	virtual UClass* GetDefaultPawnClassForController_Implementation(AController* InController) override;
+
+protected:
+	/** Spawns load test bots and starts recording when the server runs with -bmloadtest */
+	void StartLoadTest();
+
+	/** Bot controller spawned by the load test */
+	UPROPERTY(EditDefaultsOnly, Category = LoadTest)
+	TSubclassOf<class ABMShooterBotController> botControllerClass;
+
+	UPROPERTY()
+	class UBMLoadTestRecorder* loadTestRecorder;
+
+	/** Character spawned for players, streamed in while the map loads instead of when the game mode class is loaded */
+	UPROPERTY(EditDefaultsOnly, Category = Classes)
+	TSoftClassPtr<APawn> characterClass;
+
+	TSharedPtr<FStreamableHandle> characterClassHandle;
 };
 
 
@@ -0,0 +1,254 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BMShooterGameState.h"
+#include "BMShooterCharacter.h"
+#include "Subsystems/CombatEventSubsystem.h"
+#include "GameFramework/PlayerState.h"
+#include "GameFramework/Controller.h"
+#include "Engine/World.h"
+#include "Net/UnrealNetwork.h"
+#include "Serialization/MemoryWriter.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "BMShooterStats.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Match Stats Updates"), STAT_MatchStatsUpdates, STATGROUP_BMShooter);
+
+DEFINE_LOG_CATEGORY_STATIC(LogMatchStats, Log, All);
+
+// "BMMS", bump the version when the row layout changes
+static const uint32 MatchStatsMagic = 0x534D4D42;
+static const uint16 MatchStatsVersion = 1;
+
+void FBMPlayerStatsRow::PostReplicatedAdd(const FBMMatchStatsArray& arraySerializer) {
+	if (arraySerializer.gameState) {
+		arraySerializer.gameState->OnMatchStatsChanged.Broadcast();
+	}
+}
+
+void FBMPlayerStatsRow::PostReplicatedChange(const FBMMatchStatsArray& arraySerializer) {
+	if (arraySerializer.gameState) {
+		arraySerializer.gameState->OnMatchStatsChanged.Broadcast();
+	}
+}
+
+ABMShooterGameState::ABMShooterGameState() {
+	bWriteMatchStatsCsv = true;
+	bWriteMatchStatsBinary = false;
+
+	matchStats.gameState = this;
+}
+
+void ABMShooterGameState::PostInitializeComponents() {
+	Super::PostInitializeComponents();
+
+	matchStats.gameState = this;
+}
+
+void ABMShooterGameState::BeginPlay() {
+	Super::BeginPlay();
+
+	if (GetLocalRole() != ROLE_Authority) {
+		return;
+	}
+
+	matchStartTime = GetWorld()->GetTimeSeconds();
+
+	UCombatEventSubsystem* combatEvents = GetWorld()->GetSubsystem<UCombatEventSubsystem>();
+	if (combatEvents) {
+		combatEvents->OnDamageApplied.AddUObject(this, &ABMShooterGameState::HandleDamageApplied);
+		combatEvents->OnKill.AddUObject(this, &ABMShooterGameState::HandleKill);
+	}
+}
+
+void ABMShooterGameState::EndPlay(const EEndPlayReason::Type EndPlayReason) {
+	if (GetLocalRole() == ROLE_Authority) {
+		UCombatEventSubsystem* combatEvents = GetWorld()->GetSubsystem<UCombatEventSubsystem>();
+		if (combatEvents) {
+			combatEvents->OnDamageApplied.RemoveAll(this);
+			combatEvents->OnKill.RemoveAll(this);
+		}
+
+		DumpMatchStats();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ABMShooterGameState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const {
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ABMShooterGameState, matchStats);
+}
+
+int32 ABMShooterGameState::GetOrAddRow(APlayerState* player) {
+	const int32* rowIndex = rowIndices.Find(player);
+	if (rowIndex && matchStats.rows[*rowIndex].playerState == player) {
+		return *rowIndex;
+	}
+
+	const int32 newRowIndex = matchStats.rows.AddDefaulted();
+	FBMPlayerStatsRow& row = matchStats.rows[newRowIndex];
+	row.playerState = player;
+	row.playerName = player->GetPlayerName();
+	rowIndices.Add(player, newRowIndex);
+	return newRowIndex;
+}
+
+const FBMPlayerStatsRow* ABMShooterGameState::FindRow(const APlayerState* player) const {
+	if (!player) {
+		return nullptr;
+	}
+
+	const int32* rowIndex = rowIndices.Find(player);
+	if (rowIndex && matchStats.rows[*rowIndex].playerState == player) {
+		return &matchStats.rows[*rowIndex];
+	}
+
+	// clients don't have the index map, the table only has one row per player
+	return matchStats.rows.FindByPredicate([player](const FBMPlayerStatsRow& row) { return row.playerState == player; });
+}
+
+int32 ABMShooterGameState::GetKills(APlayerState* player) const {
+	const FBMPlayerStatsRow* row = FindRow(player);
+	return row ? row->kills : 0;
+}
+
+int32 ABMShooterGameState::GetDeaths(APlayerState* player) const {
+	const FBMPlayerStatsRow* row = FindRow(player);
+	return row ? row->deaths : 0;
+}
+
+int32 ABMShooterGameState::GetHits(APlayerState* player) const {
+	const FBMPlayerStatsRow* row = FindRow(player);
+	return row ? (int32)row->hits : 0;
+}
+
+int32 ABMShooterGameState::GetDamageDealt(APlayerState* player) const {
+	const FBMPlayerStatsRow* row = FindRow(player);
+	return row ? (int32)row->damageDealt : 0;
+}
+
+int32 ABMShooterGameState::GetDamageTaken(APlayerState* player) const {
+	const FBMPlayerStatsRow* row = FindRow(player);
+	return row ? (int32)row->damageTaken : 0;
+}
+
+void ABMShooterGameState::HandleDamageApplied(const FCombatDamage& damage) {
+	BM_COUNT_CALL(STAT_MatchStatsUpdates);
+
+	const uint32 damagePoints = (uint32)FMath::Max(FMath::RoundToInt(damage.total.damage), 0);
+
+	const APawn* victim = Cast<APawn>(damage.victim.Get());
+	APlayerState* victimState = victim ? victim->GetPlayerState() : nullptr;
+	if (victimState) {
+		FBMPlayerStatsRow& row = matchStats.rows[GetOrAddRow(victimState)];
+		row.damageTaken += damagePoints;
+		matchStats.MarkItemDirty(row);
+	}
+
+	const AController* instigator = damage.instigator.Get();
+	APlayerState* instigatorState = instigator ? instigator->PlayerState : nullptr;
+	if (instigatorState && instigatorState != victimState) {
+		FBMPlayerStatsRow& row = matchStats.rows[GetOrAddRow(instigatorState)];
+		row.hits += (uint32)damage.total.numHits;
+		row.damageDealt += damagePoints;
+		matchStats.MarkItemDirty(row);
+	}
+}
+
+void ABMShooterGameState::HandleKill(ABMShooterCharacter* victim, AController* killer, AActor* causer) {
+	BM_COUNT_CALL(STAT_MatchStatsUpdates);
+
+	APlayerState* victimState = victim ? victim->GetPlayerState() : nullptr;
+	if (victimState) {
+		FBMPlayerStatsRow& row = matchStats.rows[GetOrAddRow(victimState)];
+		row.deaths++;
+		matchStats.MarkItemDirty(row);
+	}
+
+	// no kill for dying to your own shots
+	APlayerState* killerState = killer ? killer->PlayerState : nullptr;
+	if (killerState && killerState != victimState) {
+		FBMPlayerStatsRow& row = matchStats.rows[GetOrAddRow(killerState)];
+		row.kills++;
+		matchStats.MarkItemDirty(row);
+	}
+}
+
+FString ABMShooterGameState::BuildCsv() const {
+	FString csv = TEXT("player,kills,deaths,hits,damage_dealt,damage_taken\n");
+	for (const FBMPlayerStatsRow& row : matchStats.rows) {
+		const FString playerName = row.playerState ? row.playerState->GetPlayerName() : row.playerName;
+		csv += FString::Printf(TEXT("%s,%u,%u,%u,%u,%u\n"), *playerName.Replace(TEXT(","), TEXT(" ")),
+			(uint32)row.kills, (uint32)row.deaths, row.hits, row.damageDealt, row.damageTaken);
+	}
+	return csv;
+}
+
+void ABMShooterGameState::BuildBinary(TArray<uint8>& outData) const {
+	FMemoryWriter writer(outData);
+
+	uint32 magic = MatchStatsMagic;
+	uint16 version = MatchStatsVersion;
+	float duration = GetWorld()->GetTimeSeconds() - matchStartTime;
+	int32 numRows = matchStats.rows.Num();
+	writer << magic << version << duration << numRows;
+
+	for (const FBMPlayerStatsRow& row : matchStats.rows) {
+		FString playerName = row.playerState ? row.playerState->GetPlayerName() : row.playerName;
+		uint16 kills = row.kills;
+		uint16 deaths = row.deaths;
+		uint32 hits = row.hits;
+		uint32 damageDealt = row.damageDealt;
+		uint32 damageTaken = row.damageTaken;
+		writer << playerName << kills << deaths << hits << damageDealt << damageTaken;
+	}
+}
+
+bool ABMShooterGameState::DumpMatchStats() {
+	if (GetLocalRole() != ROLE_Authority || matchStats.rows.Num() == 0) {
+		return false;
+	}
+
+	const FString basePath = FPaths::ProjectSavedDir() / TEXT("MatchStats") / FString::Printf(TEXT("MatchStats_%s_%s"), *GetWorld()->GetMapName(), *FDateTime::Now().ToString());
+	bool bWritten = false;
+
+	if (bWriteMatchStatsCsv) {
+		const FString csvPath = basePath + TEXT(".csv");
+		if (FFileHelper::SaveStringToFile(BuildCsv(), *csvPath)) {
+			UE_LOG(LogMatchStats, Log, TEXT("Match stats written to %s"), *csvPath);
+			bWritten = true;
+		}
+	}
+
+	if (bWriteMatchStatsBinary) {
+		TArray<uint8> data;
+		BuildBinary(data);
+
+		const FString binaryPath = basePath + TEXT(".bin");
+		if (FFileHelper::SaveArrayToFile(data, *binaryPath)) {
+			UE_LOG(LogMatchStats, Log, TEXT("Match stats written to %s (%d bytes)"), *binaryPath, data.Num());
+			bWritten = true;
+		}
+	}
+
+	return bWritten;
+}
+
+#if !UE_BUILD_SHIPPING
+// Writes the match stats table now instead of waiting for the end of the match
+static FAutoConsoleCommandWithWorldAndArgs DumpMatchStatsCommand(
+	TEXT("bm.DumpMatchStats"),
+	TEXT("bm.DumpMatchStats: server, writes the match stats table to Saved/MatchStats"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& args, UWorld* world) {
+		ABMShooterGameState* gameState = world ? world->GetGameState<ABMShooterGameState>() : nullptr;
+		if (!gameState || !gameState->DumpMatchStats()) {
+			UE_LOG(LogMatchStats, Warning, TEXT("No match stats to write"));
+		}
+	})
+);
+#endif
@@ -0,0 +1,147 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameStateBase.h"
+#include "Engine/NetSerialization.h"
+#include "BMShooterGameState.generated.h"
+
+class ABMShooterGameState;
+class ABMShooterCharacter;
+struct FCombatDamage;
+
+// Match statistics of one player, rows are only added during a match so their index never changes
+USTRUCT()
+struct FBMPlayerStatsRow : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	APlayerState* playerState = nullptr;
+
+	UPROPERTY()
+	uint16 kills = 0;
+
+	UPROPERTY()
+	uint16 deaths = 0;
+
+	// hits landed, summed per victim and tick like the damage
+	UPROPERTY()
+	uint32 hits = 0;
+
+	// in whole health points
+	UPROPERTY()
+	uint32 damageDealt = 0;
+
+	UPROPERTY()
+	uint32 damageTaken = 0;
+
+	// server only, kept for the dump in case the player left before the end of the match
+	FString playerName;
+
+	void PostReplicatedAdd(const struct FBMMatchStatsArray& arraySerializer);
+	void PostReplicatedChange(const struct FBMMatchStatsArray& arraySerializer);
+};
+
+USTRUCT()
+struct FBMMatchStatsArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FBMPlayerStatsRow> rows;
+
+	ABMShooterGameState* gameState = nullptr;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& deltaParms) {
+		return FFastArraySerializer::FastArrayDeltaSerialize<FBMPlayerStatsRow, FBMMatchStatsArray>(rows, deltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FBMMatchStatsArray> : public TStructOpsTypeTraitsBase2<FBMMatchStatsArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnMatchStatsChanged);
+
+/**
+ * Keeps the kills, deaths and damage of every player in a table of rows. The server fills it from the combat queue
+ * and only the rows that changed are sent to clients, which read them for the scoreboard. At the end of the match
+ * the table is written as CSV and/or binary in Saved/MatchStats.
+ */
+UCLASS(config=Game)
+class BMSHOOTER_API ABMShooterGameState : public AGameStateBase
+{
+	GENERATED_BODY()
+
+public:
+	ABMShooterGameState();
+
+	virtual void PostInitializeComponents() override;
+
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	UFUNCTION(BlueprintPure, Category = MatchStats)
+	int32 GetKills(APlayerState* player) const;
+
+	UFUNCTION(BlueprintPure, Category = MatchStats)
+	int32 GetDeaths(APlayerState* player) const;
+
+	UFUNCTION(BlueprintPure, Category = MatchStats)
+	int32 GetHits(APlayerState* player) const;
+
+	UFUNCTION(BlueprintPure, Category = MatchStats)
+	int32 GetDamageDealt(APlayerState* player) const;
+
+	UFUNCTION(BlueprintPure, Category = MatchStats)
+	int32 GetDamageTaken(APlayerState* player) const;
+
+	// Server: writes the table with the formats enabled in the config, returns false if nothing was written
+	bool DumpMatchStats();
+
+	// Client: a row was added or changed, for the scoreboard to refresh
+	UPROPERTY(BlueprintAssignable, Category = MatchStats)
+	FOnMatchStatsChanged OnMatchStatsChanged;
+
+	// write Saved/MatchStats/<match>.csv at the end of the match
+	UPROPERTY(config)
+	bool bWriteMatchStatsCsv;
+
+	// write Saved/MatchStats/<match>.bin at the end of the match
+	UPROPERTY(config)
+	bool bWriteMatchStatsBinary;
+
+protected:
+	// Server: row of the player, added on first use
+	int32 GetOrAddRow(APlayerState* player);
+
+	const FBMPlayerStatsRow* FindRow(const APlayerState* player) const;
+
+	void HandleDamageApplied(const FCombatDamage& damage);
+
+	void HandleKill(ABMShooterCharacter* victim, AController* killer, AActor* causer);
+
+	FString BuildCsv() const;
+
+	void BuildBinary(TArray<uint8>& outData) const;
+
+protected:
+	UPROPERTY(Replicated)
+	FBMMatchStatsArray matchStats;
+
+	// server only, row of each player so updates don't search the table. Weak keys so a player state allocated where
+	// one that left used to be doesn't take over its row
+	TMap<TWeakObjectPtr<const APlayerState>, int32> rowIndices;
+
+	float matchStartTime = 0.0f;
+};
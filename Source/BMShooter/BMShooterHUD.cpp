@@ -5,13 +5,19 @@
 #include "Engine/Texture2D.h"
 #include "TextureResource.h"
 #include "CanvasItem.h"
-#include "UObject/ConstructorHelpers.h"
+#include "Engine/AssetManager.h"
 
 ABMShooterHUD::ABMShooterHUD()
 {
 	// Set the crosshair texture
-	static ConstructorHelpers::FObjectFinder<UTexture2D> CrosshairTexObj(TEXT("/Game/FirstPerson/Textures/FirstPersonCrosshair"));
-	CrosshairTex = CrosshairTexObj.Object;
+	CrosshairTex = TSoftObjectPtr<UTexture2D>(FSoftObjectPath(TEXT("/Game/FirstPerson/Textures/FirstPersonCrosshair.FirstPersonCrosshair")));
+}
+
+void ABMShooterHUD::BeginPlay()
+{
+	Super::BeginPlay();
+
+	crosshairHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(CrosshairTex.ToSoftObjectPath());
 }
 
 
@@ -19,6 +25,12 @@ void ABMShooterHUD::DrawHUD()
 {
 	Super::DrawHUD();
 
+	// nothing to draw until the crosshair is streamed in
+	UTexture2D* crosshair = CrosshairTex.Get();
+	if (!crosshair) {
+		return;
+	}
+
 	// Draw very simple crosshair
 
 	// find center of the Canvas
@@ -29,7 +41,7 @@ void ABMShooterHUD::DrawHUD()
 										   (Center.Y + 20.0f));
 
 	// draw the crosshair
-	FCanvasTileItem TileItem( CrosshairDrawPosition, CrosshairTex->Resource, FLinearColor::White);
+	FCanvasTileItem TileItem( CrosshairDrawPosition, crosshair->Resource, FLinearColor::White);
 	TileItem.BlendMode = SE_BLEND_Translucent;
 	Canvas->DrawItem( TileItem );
 }
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/HUD.h"
+#include "Engine/StreamableManager.h"
 #include "BMShooterHUD.generated.h"
 
 UCLASS()
@@ -17,9 +18,14 @@ public:
 	/** Primary draw call for the HUD */
 	virtual void DrawHUD() override;
 
+protected:
+	virtual void BeginPlay() override;
+
 private:
-	/** Crosshair asset pointer */
-	class UTexture2D* CrosshairTex;
+	/** Crosshair asset, only loaded once a HUD is spawned so a dedicated server never loads it */
+	TSoftObjectPtr<class UTexture2D> CrosshairTex;
+
+	TSharedPtr<FStreamableHandle> crosshairHandle;
 
 };
 
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BMShooterHealthVolume.h"
+#include "Components/BoxComponent.h"
+#include "Components/HealthComponent.h"
+#include "Subsystems/HealthEffectSubsystem.h"
+#include "Engine/World.h"
+
+ABMShooterHealthVolume::ABMShooterHealthVolume() {
+	PrimaryActorTick.bCanEverTick = false;
+
+	volume = CreateDefaultSubobject<UBoxComponent>(TEXT("Volume"));
+	volume->SetBoxExtent(FVector(200.0f, 200.0f, 100.0f));
+	volume->SetCollisionProfileName(TEXT("OverlapAllDynamic"));
+	volume->SetGenerateOverlapEvents(true);
+	RootComponent = volume;
+
+	ratePerSecond = 10.0f;
+	lingerTime = 0.0f;
+	effectName = TEXT("HealthVolume");
+}
+
+void ABMShooterHealthVolume::BeginPlay() {
+	Super::BeginPlay();
+
+	// health only changes on the server
+	if (GetLocalRole() == ROLE_Authority) {
+		volume->OnComponentBeginOverlap.AddDynamic(this, &ABMShooterHealthVolume::OnVolumeBeginOverlap);
+		volume->OnComponentEndOverlap.AddDynamic(this, &ABMShooterHealthVolume::OnVolumeEndOverlap);
+	}
+}
+
+UHealthComponent* ABMShooterHealthVolume::GetHealth(AActor* actor, UPrimitiveComponent* component) const {
+	// only the root counts, a character's mesh would enter and leave separately from its capsule
+	if (!actor || component != actor->GetRootComponent()) {
+		return nullptr;
+	}
+	return actor->FindComponentByClass<UHealthComponent>();
+}
+
+void ABMShooterHealthVolume::OnVolumeBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult) {
+	UHealthComponent* health = GetHealth(OtherActor, OtherComp);
+	UHealthEffectSubsystem* healthEffects = GetWorld()->GetSubsystem<UHealthEffectSubsystem>();
+	if (health && healthEffects) {
+		healthEffects->AddEffect(health, effectName, ratePerSecond, 0.0f, GetInstigatorController(), this);
+	}
+}
+
+void ABMShooterHealthVolume::OnVolumeEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex) {
+	UHealthComponent* health = GetHealth(OtherActor, OtherComp);
+	UHealthEffectSubsystem* healthEffects = GetWorld()->GetSubsystem<UHealthEffectSubsystem>();
+	if (!health || !healthEffects) {
+		return;
+	}
+
+	// re-adding the same effect restarts it with a duration, e.g. burning for a while after leaving the fire
+	if (lingerTime > 0.0f) {
+		healthEffects->AddEffect(health, effectName, ratePerSecond, lingerTime, GetInstigatorController(), this);
+	}
+	else {
+		healthEffects->RemoveEffect(health, effectName, this);
+	}
+}
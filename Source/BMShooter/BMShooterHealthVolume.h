@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "BMShooterHealthVolume.generated.h"
+
+/**
+ * Heals or hurts whoever stands inside, e.g. a heal zone or a fire. The volume only adds a health effect on enter
+ * and removes it on exit, the health effect subsystem does the ticking.
+ */
+UCLASS()
+class BMSHOOTER_API ABMShooterHealthVolume : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ABMShooterHealthVolume();
+
+	FORCEINLINE class UBoxComponent* GetVolume() const { return volume; }
+
+protected:
+	virtual void BeginPlay() override;
+
+	UFUNCTION()
+	void OnVolumeBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+
+	UFUNCTION()
+	void OnVolumeEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+
+	class UHealthComponent* GetHealth(AActor* actor, UPrimitiveComponent* component) const;
+
+protected:
+	UPROPERTY(VisibleAnywhere, Category = Volume)
+	class UBoxComponent* volume;
+
+	// Health per second while inside, negative to damage
+	UPROPERTY(EditAnywhere, Category = Volume)
+	float ratePerSecond;
+
+	// Seconds the effect lasts after leaving the volume, 0 to stop right away
+	UPROPERTY(EditAnywhere, Category = Volume)
+	float lingerTime;
+
+	UPROPERTY(EditAnywhere, Category = Volume)
+	FName effectName;
+};
@@ -0,0 +1,13 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BMShooterPlayerController.h"
+#include "Subsystems/CosmeticFXSubsystem.h"
+#include "Engine/World.h"
+
+void ABMShooterPlayerController::ClientPlayCosmetics_Implementation(const TArray<FBMCosmeticEvent>& events) {
+	UCosmeticFXSubsystem* cosmeticFX = GetWorld()->GetSubsystem<UCosmeticFXSubsystem>();
+	if (cosmeticFX) {
+		cosmeticFX->PlayEvents(events);
+	}
+}
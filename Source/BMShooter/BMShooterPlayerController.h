@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/PlayerController.h"
+#include "Subsystems/CosmeticEventSubsystem.h"
+#include "BMShooterPlayerController.generated.h"
+
+/**
+ * Player controller of the human players, carries the per connection batch of fire and impact cosmetics.
+ */
+UCLASS()
+class BMSHOOTER_API ABMShooterPlayerController : public APlayerController
+{
+	GENERATED_BODY()
+
+public:
+	/** Cosmetics of a server frame relevant to this player, losing a batch only loses some sounds and effects */
+	UFUNCTION(Client, Unreliable)
+	void ClientPlayCosmetics(const TArray<FBMCosmeticEvent>& events);
+};
@@ -5,9 +5,20 @@
 #include "Components/SphereComponent.h"
 #include "BMShooterCharacter.h"
 #include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Net/UnrealNetwork.h"
+#include "Subsystems/ProjectilePoolSubsystem.h"
+#include "Subsystems/CombatEventSubsystem.h"
+#include "Subsystems/CosmeticEventSubsystem.h"
+#include "BMShooterStats.h"
 
-ABMShooterProjectile::ABMShooterProjectile() 
+DECLARE_CYCLE_STAT(TEXT("Projectile OnHit"), STAT_ProjectileOnHit, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile OnHit Calls"), STAT_ProjectileOnHitCalls, STATGROUP_BMShooter);
+
+ABMShooterProjectile::ABMShooterProjectile()
 {
+	BM_LLM_SCOPE(Projectiles);
+
 	// Use a sphere as a simple collision representation
 	CollisionComp = CreateDefaultSubobject<USphereComponent>(TEXT("SphereComp"));
 	CollisionComp->InitSphereRadius(5.0f);
@@ -31,24 +42,203 @@ ABMShooterProjectile::ABMShooterProjectile()
 
 	// Die after 3 seconds by default
 	InitialLifeSpan = 3.0f;
+
+	explosionRadius = 0.0f;
+	explosionInnerRadius = 0.0f;
+	explosionMinDamage = 0.0f;
+	explosionFalloff = 1.0f;
+}
+
+BMCombat::FRadialDamage ABMShooterProjectile::GetRadialDamage() const {
+	BMCombat::FRadialDamage radial;
+	radial.baseDamage = damage;
+	radial.minDamage = explosionMinDamage;
+	radial.innerRadius = explosionInnerRadius;
+	radial.outerRadius = explosionRadius;
+	radial.falloff = explosionFalloff;
+	return radial;
 }
 
 void ABMShooterProjectile::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
+	BM_SCOPE_CYCLE_COUNTER(STAT_ProjectileOnHit);
+	BM_COUNT_CALL(STAT_ProjectileOnHitCalls);
+
+	if (bPredicted) {
+		// cosmetic only, the server projectile decides what was hit
+		if ((OtherActor != NULL) && (OtherActor != this) && (GetInstigator() != OtherActor) && !bPredictedImpact) {
+			bPredictedImpact = true;
+			poolLaunch.active = false;
+			ApplyLaunchState();
+		}
+		return;
+	}
+
 	// if server
-	if (GetLocalRole() == ROLE_Authority) {
+	if (GetLocalRole() == ROLE_Authority && IsExplosive()) {
+		if ((OtherActor != NULL) && (OtherActor != this) && (GetInstigator() != OtherActor)) {
+			// from the projectile's center, the impact point is on the surface and would shield the blast
+			UCombatEventSubsystem::ApplyRadialHit(GetWorld(), GetActorLocation(), GetRadialDamage(), GetInstigatorController(), GetInstigator());
+			Release();
+			return;
+		}
+	}
+	else if (GetLocalRole() == ROLE_Authority) {
 		if ((OtherActor != NULL) && (OtherActor != this) && (GetInstigator() != OtherActor) && OtherActor->IsA(ABMShooterCharacter::StaticClass())) {
-			FDamageEvent damageEvent;
-			// instigate damage
-			OtherActor->TakeDamage(damage, damageEvent, GetInstigatorController(), GetInstigator());
-			Destroy(true, true); // destroy only on server
+			// instigate damage, applied with the other hits of this tick
+			UCombatEventSubsystem::ApplyHit(GetWorld(), OtherActor, damage, GetInstigatorController(), GetInstigator());
+			UCosmeticEventSubsystem::QueueEvent(GetWorld(), EBMCosmeticType::Impact, Hit.ImpactPoint, Hit.ImpactNormal, Cast<ABMShooterCharacter>(GetInstigator()));
+			Release(); // back to the pool, only on server
 		}
 	}
 	// if hit a simulating physic object add impulse
 	if ((OtherActor != NULL) && (OtherActor != this) && (OtherComp != NULL) && OtherComp->IsSimulatingPhysics()) {
 		OtherComp->AddImpulseAtLocation(GetVelocity() * 100.0f, GetActorLocation());
 
-		Destroy();
+		Release();
+	}
+
+}
+
+void ABMShooterProjectile::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const {
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ABMShooterProjectile, poolLaunch);
+}
+
+void ABMShooterProjectile::PostNetInit() {
+	Super::PostNetInit();
+
+	// a prewarmed projectile replicates parked, which is the default launch state so the rep notify never fires, and
+	// the copy would fly hidden with collision on. Active launches already went through OnRep_PoolLaunch
+	if (GetLocalRole() != ROLE_Authority && !poolLaunch.active) {
+		ApplyLaunchState();
+	}
+}
+
+void ABMShooterProjectile::LifeSpanExpired() {
+	if (bPooled) {
+		Release();
+	}
+	else {
+		Super::LifeSpanExpired();
+	}
+}
+
+void ABMShooterProjectile::Release() {
+	if (bPooled) {
+		UProjectilePoolSubsystem* pool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>();
+		if (pool) {
+			pool->ReleaseProjectile(this);
+			return;
+		}
+	}
+	else if (GetLocalRole() != ROLE_Authority && poolLaunch.launchCount > 0) {
+		// replicated copy of a pooled projectile, park it until the server launches it again
+		poolLaunch.active = false;
+		ApplyLaunchState();
+		return;
+	}
+
+	Destroy();
+}
+
+void ABMShooterProjectile::ActivateFromPool(const FTransform& spawnTransform, AActor* newOwner, APawn* newInstigator) {
+	SetOwner(newOwner);
+	SetInstigator(newInstigator);
+
+	poolLaunch.origin = spawnTransform.GetLocation();
+	poolLaunch.direction = spawnTransform.GetRotation().Vector();
+	poolLaunch.launchCount++;
+	poolLaunch.active = true;
+	poolLaunch.shotId = 0;
+
+	if (GetIsReplicated()) {
+		// wake up the channel so clients get the new launch state right away
+		SetNetDormancy(DORM_Awake);
+		ForceNetUpdate();
+	}
+
+	ApplyLaunchState();
+
+	// SetLifeSpan overwrites InitialLifeSpan, so always take it from the class defaults
+	SetLifeSpan(GetClass()->GetDefaultObject<ABMShooterProjectile>()->InitialLifeSpan);
+}
+
+void ABMShooterProjectile::DeactivateToPool() {
+	SetLifeSpan(0.0f);
+
+	poolLaunch.active = false;
+	ApplyLaunchState();
+
+	SetOwner(nullptr);
+	SetInstigator(nullptr);
+
+	if (GetIsReplicated()) {
+		// the parked state is sent before the channel goes dormant
+		SetNetDormancy(DORM_DormantAll);
 	}
+}
 
-}
\ No newline at end of file
+void ABMShooterProjectile::ApplyLaunchState() {
+	if (poolLaunch.active) {
+		SetActorLocationAndRotation(poolLaunch.origin, poolLaunch.direction.Rotation(), false, nullptr, ETeleportType::ResetPhysics);
+		SetActorHiddenInGame(false);
+		SetActorEnableCollision(true);
+
+		// restart the movement as if the projectile had just been spawned
+		ProjectileMovement->SetUpdatedComponent(CollisionComp);
+		ProjectileMovement->Velocity = poolLaunch.direction * ProjectileMovement->InitialSpeed;
+		ProjectileMovement->UpdateComponentVelocity();
+		ProjectileMovement->Activate(true);
+	}
+	else {
+		ProjectileMovement->StopMovementImmediately();
+		ProjectileMovement->Deactivate();
+		SetActorEnableCollision(false);
+		SetActorHiddenInGame(true);
+	}
+}
+
+void ABMShooterProjectile::SetShotId(uint16 shotId) {
+	poolLaunch.shotId = shotId;
+}
+
+void ABMShooterProjectile::InitPrediction(uint16 shotId) {
+	bPredicted = true;
+	SetReplicates(false);
+
+	poolLaunch.origin = GetActorLocation();
+	poolLaunch.direction = GetActorForwardVector();
+	poolLaunch.shotId = shotId;
+	poolLaunch.active = true;
+}
+
+void ABMShooterProjectile::MergePrediction(const ABMShooterProjectile* prediction) {
+	SetActorLocationAndRotation(prediction->GetActorLocation(), prediction->GetActorRotation(), false, nullptr, ETeleportType::TeleportPhysics);
+	ProjectileMovement->Velocity = prediction->GetVelocity();
+	ProjectileMovement->UpdateComponentVelocity();
+}
+
+void ABMShooterProjectile::InitSimulatedVisual() {
+	SetReplicates(false);
+	// spawning a replicated class on a listen server registered it with the net driver
+	GetWorld()->RemoveNetworkActor(this);
+
+	SetLifeSpan(0.0f);
+	ProjectileMovement->StopMovementImmediately();
+	ProjectileMovement->Deactivate();
+	SetActorEnableCollision(false);
+}
+
+void ABMShooterProjectile::OnRep_PoolLaunch() {
+	ApplyLaunchState();
+
+	// the owning client may have been showing its own copy of this shot
+	if (poolLaunch.active && poolLaunch.shotId != 0) {
+		ABMShooterCharacter* shooter = Cast<ABMShooterCharacter>(GetOwner());
+		if (shooter && shooter->IsLocallyControlled()) {
+			shooter->ReconcilePredictedProjectile(this);
+		}
+	}
+}
@@ -4,13 +4,41 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Engine/NetSerialization.h"
+#include "CombatCore/CombatRules.h"
 #include "BMShooterProjectile.generated.h"
 
+// Launch state of a pooled projectile, replicated so clients restart the flight when the server recycles it
+USTRUCT()
+struct FBMProjectileLaunch
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize origin;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal direction;
+
+	// bumped on every activation so two shots from the same spot still trigger the rep notify
+	UPROPERTY()
+	uint8 launchCount = 0;
+
+	UPROPERTY()
+	bool active = false;
+
+	// shot of the owning client this launch answers, 0 if the client did not predict it
+	UPROPERTY()
+	uint16 shotId = 0;
+};
+
 UCLASS(config=Game)
 class ABMShooterProjectile : public AActor
 {
 	GENERATED_BODY()
 
+	friend class UProjectilePoolSubsystem;
+
 	/** Sphere collision component */
 	UPROPERTY(VisibleDefaultsOnly, Category=Projectile)
 	class USphereComponent* CollisionComp;
@@ -32,10 +60,89 @@ public:
 	/** Returns ProjectileMovement subobject **/
 	FORCEINLINE class UProjectileMovementComponent* GetProjectileMovement() const { return ProjectileMovement; }
 
+	// Property replication
+	void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	// Client: parks a copy that first replicates as a parked pooled projectile
+	virtual void PostNetInit() override;
+
+	// pooled projectiles go back to the pool instead of being destroyed
+	virtual void LifeSpanExpired() override;
+
+	// Returns the projectile to its pool, or destroys it if it was not spawned from one
+	UFUNCTION(BlueprintCallable, Category = Projectile)
+	void Release();
+
+	FORCEINLINE bool IsPooled() const { return bPooled; }
+
+	FORCEINLINE float GetDamage() const { return damage; }
+
+	FORCEINLINE bool IsExplosive() const { return explosionRadius > 0.0f; }
+
+	// Explosion of the projectile, damage falling off from its center
+	BMCombat::FRadialDamage GetRadialDamage() const;
+
+	FORCEINLINE const FBMProjectileLaunch& GetLaunch() const { return poolLaunch; }
+
+	// Server: tags the launch with the client shot it answers, so the client can match it with its prediction
+	void SetShotId(uint16 shotId);
+
+	// Client: marks a locally spawned projectile as the prediction of a shot, it never deals damage
+	void InitPrediction(uint16 shotId);
+
+	FORCEINLINE bool IsPredicted() const { return bPredicted; }
+
+	// true once a prediction hit something, it stays hidden until the server projectile arrives
+	FORCEINLINE bool HasPredictedImpact() const { return bPredictedImpact; }
+
+	// Client: continues the flight from where the prediction is, so the switch is not visible
+	void MergePrediction(const ABMShooterProjectile* prediction);
+
+	// Turns a locally spawned projectile into the look of a shot flown by UProjectileSimulationSubsystem, it is moved
+	// by the simulation and never moves, collides or expires by itself
+	void InitSimulatedVisual();
+
 protected:
 
+	// Puts the projectile back in flight from the given transform (server)
+	void ActivateFromPool(const FTransform& spawnTransform, AActor* newOwner, APawn* newInstigator);
+
+	// Stops, hides and disables the projectile until the pool hands it out again (server)
+	void DeactivateToPool();
+
+	// Restarts or parks the projectile locally from the launch state
+	void ApplyLaunchState();
+
+	UFUNCTION()
+	void OnRep_PoolLaunch();
+
 	// Damage of the projectile
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Damage)
 	float damage;
+
+	// Radius of the explosion on impact, 0 for a projectile that only damages what it hits
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Damage)
+	float explosionRadius;
+
+	// Characters closer than this take the full damage
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Damage)
+	float explosionInnerRadius;
+
+	// Damage at the edge of the explosion
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Damage)
+	float explosionMinDamage;
+
+	// 1 falls off linearly, higher drops off sooner past the inner radius
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Damage)
+	float explosionFalloff;
+
+	UPROPERTY(ReplicatedUsing = OnRep_PoolLaunch)
+	FBMProjectileLaunch poolLaunch;
+
+	// true when owned by UProjectilePoolSubsystem
+	bool bPooled = false;
+
+	bool bPredicted = false;
+	bool bPredictedImpact = false;
 };
 
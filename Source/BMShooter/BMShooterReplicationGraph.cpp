@@ -0,0 +1,228 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "BMShooterReplicationGraph.h"
+#include "BMShooterCharacter.h"
+#include "BMShooterProjectile.h"
+#include "Engine/LevelScriptActor.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/Info.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "UObject/UObjectIterator.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogBMReplicationGraph, Log, All);
+
+UBMShooterReplicationGraph::UBMShooterReplicationGraph() {
+	gridCellSize = 10000.0f;
+	spatialBiasX = -150000.0f;
+	spatialBiasY = -200000.0f;
+	deadCharacterPeriodFrames = 10;
+}
+
+void UBMShooterReplicationGraph::InitGlobalActorClassSettings() {
+	Super::InitGlobalActorClassSettings();
+
+	// routing, looked up through the class hierarchy so Blueprint subclasses inherit it
+	classRepNodePolicies.Set(AActor::StaticClass(), EBMClassRepNodeMapping::Spatialize_Dynamic);
+	classRepNodePolicies.Set(AInfo::StaticClass(), EBMClassRepNodeMapping::RelevantAllConnections);
+	classRepNodePolicies.Set(AGameStateBase::StaticClass(), EBMClassRepNodeMapping::RelevantAllConnections);
+	classRepNodePolicies.Set(ALevelScriptActor::StaticClass(), EBMClassRepNodeMapping::NotRouted);
+	classRepNodePolicies.Set(AReplicationGraphDebugActor::StaticClass(), EBMClassRepNodeMapping::NotRouted);
+	// gathered by the player state frequency limiter and the per connection nodes
+	classRepNodePolicies.Set(APlayerState::StaticClass(), EBMClassRepNodeMapping::NotRouted);
+	classRepNodePolicies.Set(APlayerController::StaticClass(), EBMClassRepNodeMapping::NotRouted);
+	classRepNodePolicies.Set(ABMShooterCharacter::StaticClass(), EBMClassRepNodeMapping::Spatialize_Dynamic);
+	classRepNodePolicies.Set(ABMShooterProjectile::StaticClass(), EBMClassRepNodeMapping::Spatialize_Dormancy);
+
+	// update rate and cull distance of every replicated class, from its defaults
+	const float serverMaxTickRate = FMath::Max<float>(NetDriver->NetServerMaxTickRate, 1.0f);
+	for (TObjectIterator<UClass> it; it; ++it) {
+		UClass* actorClass = *it;
+		const AActor* actorCDO = Cast<AActor>(actorClass->GetDefaultObject(false));
+		if (!actorCDO || !actorCDO->GetIsReplicated()) {
+			continue;
+		}
+
+		// skip Blueprint compilation leftovers
+		if (actorClass->GetName().StartsWith(TEXT("SKEL_")) || actorClass->GetName().StartsWith(TEXT("REINST_"))) {
+			continue;
+		}
+
+		FClassReplicationInfo classInfo;
+		classInfo.ReplicationPeriodFrame = FMath::Max<uint32>((uint32)FMath::RoundToFloat(serverMaxTickRate / FMath::Max(actorCDO->NetUpdateFrequency, 1.0f)), 1);
+
+		const EBMClassRepNodeMapping mapping = GetMappingPolicy(actorClass);
+		if (mapping == EBMClassRepNodeMapping::Spatialize_Static || mapping == EBMClassRepNodeMapping::Spatialize_Dynamic || mapping == EBMClassRepNodeMapping::Spatialize_Dormancy) {
+			classInfo.CullDistanceSquared = actorCDO->NetCullDistanceSquared;
+		}
+
+		GlobalActorReplicationInfoMap.SetClassInfo(actorClass, classInfo);
+	}
+}
+
+void UBMShooterReplicationGraph::InitGlobalGraphNodes() {
+	// lists used by the grid cells, preallocated to avoid growing them during gathering
+	PreAllocateRepList(3, 12);
+	PreAllocateRepList(6, 12);
+	PreAllocateRepList(128, 64);
+
+	gridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	gridNode->CellSize = gridCellSize;
+	gridNode->SpatialBias = FVector2D(spatialBiasX, spatialBiasY);
+	AddGlobalGraphNode(gridNode);
+
+	alwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(alwaysRelevantNode);
+
+	// player states are relevant to everyone but don't need to go out every frame
+	UReplicationGraphNode_PlayerStateFrequencyLimiter* playerStateNode = CreateNewNode<UReplicationGraphNode_PlayerStateFrequencyLimiter>();
+	AddGlobalGraphNode(playerStateNode);
+}
+
+void UBMShooterReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) {
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	// also gathers the connection's player controller, pawn and view target
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* ownerNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(ownerNode, RepGraphConnection);
+	ownerOnlyNodes.Add(RepGraphConnection->NetConnection, ownerNode);
+}
+
+void UBMShooterReplicationGraph::RemoveClientConnection(UNetConnection* NetConnection) {
+	ownerOnlyNodes.Remove(NetConnection);
+
+	Super::RemoveClientConnection(NetConnection);
+}
+
+EBMClassRepNodeMapping UBMShooterReplicationGraph::GetMappingPolicy(UClass* actorClass) {
+	const EBMClassRepNodeMapping* mapping = classRepNodePolicies.Get(actorClass);
+	const EBMClassRepNodeMapping policy = mapping ? *mapping : EBMClassRepNodeMapping::NotRouted;
+	if (policy == EBMClassRepNodeMapping::NotRouted) {
+		return policy;
+	}
+
+	// relevancy flags of the class win over the spatialized defaults
+	const AActor* actorCDO = actorClass->GetDefaultObject<AActor>();
+	if (actorCDO && actorCDO->bOnlyRelevantToOwner) {
+		return EBMClassRepNodeMapping::RelevantOwnerOnly;
+	}
+
+	if (actorCDO && actorCDO->bAlwaysRelevant) {
+		return EBMClassRepNodeMapping::RelevantAllConnections;
+	}
+
+	return policy;
+}
+
+UReplicationGraphNode_AlwaysRelevant_ForConnection* UBMShooterReplicationGraph::GetOwnerNode(const AActor* actor) const {
+	UNetConnection* netConnection = actor ? actor->GetNetConnection() : nullptr;
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* const* ownerNode = netConnection ? ownerOnlyNodes.Find(netConnection) : nullptr;
+	return ownerNode ? *ownerNode : nullptr;
+}
+
+void UBMShooterReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) {
+	switch (GetMappingPolicy(ActorInfo.Class)) {
+	case EBMClassRepNodeMapping::RelevantAllConnections:
+		alwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+
+	case EBMClassRepNodeMapping::RelevantOwnerOnly:
+		if (UReplicationGraphNode_AlwaysRelevant_ForConnection* ownerNode = GetOwnerNode(ActorInfo.Actor)) {
+			ownerNode->NotifyAddNetworkActor(ActorInfo);
+		}
+		else {
+			UE_LOG(LogBMReplicationGraph, Verbose, TEXT("%s is owner only but has no owning connection yet"), *GetNameSafe(ActorInfo.Actor));
+		}
+		break;
+
+	case EBMClassRepNodeMapping::Spatialize_Static:
+		gridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+
+	case EBMClassRepNodeMapping::Spatialize_Dynamic:
+		gridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+
+	case EBMClassRepNodeMapping::Spatialize_Dormancy:
+		gridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void UBMShooterReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) {
+	switch (GetMappingPolicy(ActorInfo.Class)) {
+	case EBMClassRepNodeMapping::RelevantAllConnections:
+		alwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+
+	case EBMClassRepNodeMapping::RelevantOwnerOnly:
+		// the connection may already be gone, so look in every node
+		for (const TPair<UNetConnection*, UReplicationGraphNode_AlwaysRelevant_ForConnection*>& ownerNode : ownerOnlyNodes) {
+			ownerNode.Value->NotifyRemoveNetworkActor(ActorInfo, false);
+		}
+		break;
+
+	case EBMClassRepNodeMapping::Spatialize_Static:
+		gridNode->RemoveActor_Static(ActorInfo);
+		break;
+
+	case EBMClassRepNodeMapping::Spatialize_Dynamic:
+		gridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+
+	case EBMClassRepNodeMapping::Spatialize_Dormancy:
+		gridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void UBMShooterReplicationGraph::NotifyCharacterDead(ABMShooterCharacter* character, bool bDead) {
+	UNetDriver* netDriver = character ? character->GetNetDriver() : nullptr;
+	UBMShooterReplicationGraph* graph = netDriver ? netDriver->GetReplicationDriver<UBMShooterReplicationGraph>() : nullptr;
+	if (!graph) {
+		return;
+	}
+
+	FGlobalActorReplicationInfo* globalInfo = graph->GlobalActorReplicationInfoMap.Find(character);
+	if (!globalInfo) {
+		return;
+	}
+
+	const uint32 classPeriod = graph->GlobalActorReplicationInfoMap.GetClassInfo(character->GetClass()).ReplicationPeriodFrame;
+	const uint32 periodFrames = bDead ? FMath::Max<uint32>(classPeriod, graph->deadCharacterPeriodFrames) : classPeriod;
+	globalInfo->Settings.ReplicationPeriodFrame = periodFrames;
+
+	// connections copy the global period the first time they gather the actor, the ones that already did need it too.
+	// on respawn this drops the significance period as well, the next significance update sets it again
+	for (UNetReplicationGraphConnection* connection : graph->Connections) {
+		FConnectionReplicationActorInfo* connectionInfo = connection ? connection->ActorInfoMap.Find(character) : nullptr;
+		if (connectionInfo) {
+			connectionInfo->ReplicationPeriodFrame = periodFrames;
+		}
+	}
+}
+
+bool UBMShooterReplicationGraph::SetConnectionPeriodFrame(UNetConnection* connection, AActor* actor, uint32 periodFrames) {
+	UNetDriver* netDriver = connection ? connection->Driver : nullptr;
+	UBMShooterReplicationGraph* graph = netDriver ? netDriver->GetReplicationDriver<UBMShooterReplicationGraph>() : nullptr;
+	UNetReplicationGraphConnection* graphConnection = connection ? Cast<UNetReplicationGraphConnection>(connection->GetReplicationConnectionDriver()) : nullptr;
+	if (!graph || !graphConnection || !actor) {
+		return false;
+	}
+
+	// the global period already holds the class rate and the dead character bucket
+	const FGlobalActorReplicationInfo* globalInfo = graph->GlobalActorReplicationInfoMap.Find(actor);
+	const uint32 globalPeriod = globalInfo ? globalInfo->Settings.ReplicationPeriodFrame : 1;
+
+	FConnectionReplicationActorInfo& connectionInfo = graphConnection->ActorInfoMap.FindOrAdd(actor);
+	connectionInfo.ReplicationPeriodFrame = FMath::Max(globalPeriod, periodFrames);
+	return true;
+}
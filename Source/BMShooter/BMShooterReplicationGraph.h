@@ -0,0 +1,90 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "BMShooterReplicationGraph.generated.h"
+
+class ABMShooterCharacter;
+class UReplicationGraphNode_GridSpatialization2D;
+class UReplicationGraphNode_ActorList;
+class UReplicationGraphNode_AlwaysRelevant_ForConnection;
+
+// How actors of a class are routed to the graph nodes
+enum class EBMClassRepNodeMapping : uint8
+{
+	// not added to any node, something else gathers it (player controllers, player states)
+	NotRouted,
+	// replicated to every connection
+	RelevantAllConnections,
+	// only replicated to the owning connection
+	RelevantOwnerOnly,
+	// grid, the actor never moves
+	Spatialize_Static,
+	// grid, the actor moves every frame
+	Spatialize_Dynamic,
+	// grid, static while dormant and dynamic while awake (pooled projectiles)
+	Spatialize_Dormancy,
+};
+
+/**
+ * Replication graph of the game: characters and projectiles go in a 2D grid so each connection only
+ * gathers the cells around its viewer, game state/info actors are relevant to everyone and owner-only
+ * actors are only gathered for their connection. Dead characters are replicated at a lower rate.
+ */
+UCLASS(transient, config=Engine)
+class BMSHOOTER_API UBMShooterReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	UBMShooterReplicationGraph();
+
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual void RemoveClientConnection(UNetConnection* NetConnection) override;
+
+	// Moves the character to the low frequency bucket while it is dead, and back when it respawns
+	static void NotifyCharacterDead(ABMShooterCharacter* character, bool bDead);
+
+	/**
+	 * Sets how many frames apart the actor replicates to one connection, never more often than its global settings.
+	 * @return false if the connection does not replicate through this graph
+	 */
+	static bool SetConnectionPeriodFrame(UNetConnection* connection, AActor* actor, uint32 periodFrames);
+
+	// Size of a grid cell, in uu
+	UPROPERTY(config)
+	float gridCellSize;
+
+	// Lowest X/Y of the map, so grid cells start there
+	UPROPERTY(config)
+	float spatialBiasX;
+
+	UPROPERTY(config)
+	float spatialBiasY;
+
+	// Replication frames between two updates of a dead character
+	UPROPERTY(config)
+	int32 deadCharacterPeriodFrames;
+
+protected:
+	EBMClassRepNodeMapping GetMappingPolicy(UClass* actorClass);
+
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* GetOwnerNode(const AActor* actor) const;
+
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* gridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* alwaysRelevantNode;
+
+	UPROPERTY()
+	TMap<UNetConnection*, UReplicationGraphNode_AlwaysRelevant_ForConnection*> ownerOnlyNodes;
+
+	TClassMap<EBMClassRepNodeMapping> classRepNodePolicies;
+};
@@ -0,0 +1,232 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BMShooterShotStream.h"
+#include "BMShooterProjectile.h"
+#include "BMShooterCharacter.h"
+#include "Subsystems/ProjectileSimulationSubsystem.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "GameFramework/GameStateBase.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+#include "Net/UnrealNetwork.h"
+#include "HAL/IConsoleManager.h"
+#include "BMShooterStats.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Shot Stream Entries"), STAT_ShotStreamEntries, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shot Stream Shots"), STAT_ShotStreamShots, STATGROUP_BMShooter);
+
+DEFINE_LOG_CATEGORY_STATIC(LogShotStream, Log, All);
+
+static TAutoConsoleVariable<int32> CVarShotStream(
+	TEXT("bm.ShotStream"),
+	1,
+	TEXT("1: projectile shots replicate through the shot stream, 0: as pooled projectile actors"));
+
+// projectile shots launched by the server since startup
+static uint32 GNumProjectileShots = 0;
+
+void FBMShotStreamEntry::PostReplicatedAdd(const FBMShotStreamArray& arraySerializer) {
+	if (arraySerializer.stream) {
+		arraySerializer.stream->OnShotAdded(*this);
+	}
+}
+
+void FBMShotStreamEntry::PostReplicatedChange(const FBMShotStreamArray& arraySerializer) {
+	if (arraySerializer.stream && bEnded) {
+		arraySerializer.stream->OnShotEnded(*this);
+	}
+}
+
+void FBMShotStreamEntry::PreReplicatedRemove(const FBMShotStreamArray& arraySerializer) {
+	if (arraySerializer.stream) {
+		arraySerializer.stream->OnShotEnded(*this);
+	}
+}
+
+ABMShooterShotStream::ABMShooterShotStream() {
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickInterval = 0.1f;
+
+	SetReplicates(true);
+	bAlwaysRelevant = true;
+	NetUpdateFrequency = 30.0f;
+
+	endedShotLinger = 1.0f;
+	shotArray.stream = this;
+}
+
+void ABMShooterShotStream::PostInitializeComponents() {
+	Super::PostInitializeComponents();
+
+	shotArray.stream = this;
+
+	if (GetLocalRole() == ROLE_Authority) {
+		UProjectileSimulationSubsystem* simulation = GetWorld()->GetSubsystem<UProjectileSimulationSubsystem>();
+		if (simulation) {
+			simulation->OnShotEnded.AddUObject(this, &ABMShooterShotStream::HandleShotEnded);
+		}
+	}
+}
+
+void ABMShooterShotStream::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const {
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ABMShooterShotStream, shotArray);
+	DOREPLIFETIME(ABMShooterShotStream, projectileClasses);
+}
+
+void ABMShooterShotStream::CountShot() {
+	GNumProjectileShots++;
+	BM_COUNT_CALL(STAT_ShotStreamShots);
+}
+
+bool ABMShooterShotStream::IsEnabled() {
+	return CVarShotStream.GetValueOnGameThread() != 0;
+}
+
+void ABMShooterShotStream::FireShot(TSubclassOf<ABMShooterProjectile> projectileClass, const FVector& origin, const FVector& direction, APawn* instigator, uint16 clientShotId) {
+	UProjectileSimulationSubsystem* simulation = GetWorld()->GetSubsystem<UProjectileSimulationSubsystem>();
+	if (!simulation || !projectileClass) {
+		return;
+	}
+
+	int32 classIndex = projectileClasses.IndexOfByKey(projectileClass);
+	if (classIndex == INDEX_NONE) {
+		if (projectileClasses.Num() > MAX_uint8) {
+			return;
+		}
+		classIndex = projectileClasses.Add(projectileClass);
+	}
+
+	// 0 means not streamed in the simulation
+	lastShotId = lastShotId == MAX_uint32 ? 1 : lastShotId + 1;
+
+	FBMShotStreamEntry& entry = shotArray.shots.AddDefaulted_GetRef();
+	entry.shotId = lastShotId;
+	entry.clientShotId = clientShotId;
+	entry.origin = origin;
+	entry.direction = direction;
+	entry.spawnServerTime = GetWorld()->GetTimeSeconds();
+	entry.classIndex = (uint8)classIndex;
+	entry.instigator = instigator;
+	shotArray.MarkItemDirty(entry);
+
+	simulation->SpawnShot(projectileClass, origin, direction, instigator, lastShotId, 0.0f);
+	SET_DWORD_STAT(STAT_ShotStreamEntries, shotArray.shots.Num());
+}
+
+void ABMShooterShotStream::HandleShotEnded(uint32 shotId, const FVector& location) {
+	FBMShotStreamEntry* entry = shotArray.shots.FindByPredicate([shotId](const FBMShotStreamEntry& other) { return other.shotId == shotId; });
+	if (!entry || entry->bEnded) {
+		return;
+	}
+
+	entry->bEnded = true;
+	entry->endLocation = location;
+	entry->endTime = GetWorld()->GetTimeSeconds();
+	shotArray.MarkItemDirty(*entry);
+}
+
+void ABMShooterShotStream::Tick(float DeltaSeconds) {
+	Super::Tick(DeltaSeconds);
+
+	if (GetLocalRole() != ROLE_Authority) {
+		return;
+	}
+
+	// ended shots are dropped once every client had time to get the end
+	const float now = GetWorld()->GetTimeSeconds();
+	const int32 numRemoved = shotArray.shots.RemoveAll([now, this](const FBMShotStreamEntry& entry) {
+		return entry.bEnded && now - entry.endTime > endedShotLinger;
+	});
+	if (numRemoved > 0) {
+		shotArray.MarkArrayDirty();
+		SET_DWORD_STAT(STAT_ShotStreamEntries, shotArray.shots.Num());
+	}
+}
+
+void ABMShooterShotStream::OnShotAdded(const FBMShotStreamEntry& entry) {
+	if (!projectileClasses.IsValidIndex(entry.classIndex)) {
+		return;
+	}
+	const TSubclassOf<ABMShooterProjectile> projectileClass = projectileClasses[entry.classIndex];
+
+	// the owner keeps its prediction of the shot if it is close enough, until the server shot ends
+	ABMShooterCharacter* shooter = Cast<ABMShooterCharacter>(entry.instigator);
+	if (shooter && shooter->IsLocallyControlled() && entry.clientShotId != 0) {
+		const float initialSpeed = projectileClass->GetDefaultObject<ABMShooterProjectile>()->GetProjectileMovement()->InitialSpeed;
+		ABMShooterProjectile* prediction = shooter->ReconcileStreamedShot(entry.clientShotId, entry.origin, entry.direction, initialSpeed);
+		if (prediction) {
+			ownerPredictions.Add(entry.shotId, prediction);
+			if (entry.bEnded) {
+				OnShotEnded(entry);
+			}
+			return;
+		}
+	}
+
+	UProjectileSimulationSubsystem* simulation = GetWorld()->GetSubsystem<UProjectileSimulationSubsystem>();
+	if (entry.bEnded || !simulation) {
+		return;
+	}
+
+	// fly the part of the shot that happened while the record was on its way
+	AGameStateBase* gameState = GetWorld()->GetGameState();
+	const float serverTime = gameState ? gameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+	const float catchUpTime = FMath::Clamp(serverTime - entry.spawnServerTime, 0.0f, 0.5f);
+
+	simulation->SpawnShot(projectileClass, entry.origin, entry.direction, entry.instigator, entry.shotId, catchUpTime);
+}
+
+void ABMShooterShotStream::OnShotEnded(const FBMShotStreamEntry& entry) {
+	TWeakObjectPtr<ABMShooterProjectile> prediction;
+	if (ownerPredictions.RemoveAndCopyValue(entry.shotId, prediction)) {
+		if (prediction.IsValid()) {
+			prediction->Destroy();
+		}
+		return;
+	}
+
+	UProjectileSimulationSubsystem* simulation = GetWorld()->GetSubsystem<UProjectileSimulationSubsystem>();
+	if (simulation) {
+		simulation->RemoveShot(entry.shotId);
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+// Logs the channels open per connection and the bytes sent per projectile shot since the last call, run it under
+// sustained automatic fire with bm.ShotStream 1 and 0 to compare both paths
+static FAutoConsoleCommandWithWorldAndArgs NetChannelsCommand(
+	TEXT("bm.NetChannels"),
+	TEXT("bm.NetChannels: server, logs open channels per connection and bytes sent per projectile shot since the last call"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& args, UWorld* world) {
+		UNetDriver* netDriver = world ? world->GetNetDriver() : nullptr;
+		if (!netDriver || !netDriver->IsServer()) {
+			return;
+		}
+
+		static uint32 lastOutBytes = 0;
+		static uint32 lastShots = 0;
+
+		int32 totalChannels = 0;
+		for (UNetConnection* connection : netDriver->ClientConnections) {
+			if (!connection) {
+				continue;
+			}
+
+			UE_LOG(LogShotStream, Log, TEXT("%s: %d open channels, %d B/s out"), *connection->LowLevelGetRemoteAddress(true), connection->OpenChannels.Num(), connection->OutBytesPerSecond);
+			totalChannels += connection->OpenChannels.Num();
+		}
+
+		const uint32 outBytes = netDriver->OutTotalBytes - lastOutBytes;
+		const uint32 shots = GNumProjectileShots - lastShots;
+		lastOutBytes = netDriver->OutTotalBytes;
+		lastShots = GNumProjectileShots;
+
+		UE_LOG(LogShotStream, Log, TEXT("%s path: %d open channels, %u bytes out for %u shots, %.1f bytes per shot"),
+			ABMShooterShotStream::IsEnabled() ? TEXT("stream") : TEXT("actor"), totalChannels, outBytes, shots, shots > 0 ? (float)outBytes / shots : 0.0f);
+	})
+);
+#endif
@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "Engine/NetSerialization.h"
+#include "BMShooterShotStream.generated.h"
+
+class ABMShooterProjectile;
+class ABMShooterShotStream;
+
+// A projectile shot as clients receive it, enough to fly it locally
+USTRUCT()
+struct FBMShotStreamEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint32 shotId = 0;
+
+	// shot of the owning client this entry answers, 0 if the client did not predict it
+	UPROPERTY()
+	uint16 clientShotId = 0;
+
+	UPROPERTY()
+	FVector_NetQuantize origin;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal direction;
+
+	UPROPERTY()
+	float spawnServerTime = 0.0f;
+
+	// index in ABMShooterShotStream::projectileClasses
+	UPROPERTY()
+	uint8 classIndex = 0;
+
+	UPROPERTY()
+	APawn* instigator = nullptr;
+
+	// set once the server projectile hit something or expired
+	UPROPERTY()
+	bool bEnded = false;
+
+	UPROPERTY()
+	FVector_NetQuantize endLocation;
+
+	// server only, the entry is removed a little after the shot ended
+	float endTime = 0.0f;
+
+	void PostReplicatedAdd(const struct FBMShotStreamArray& arraySerializer);
+	void PostReplicatedChange(const struct FBMShotStreamArray& arraySerializer);
+	void PreReplicatedRemove(const struct FBMShotStreamArray& arraySerializer);
+};
+
+USTRUCT()
+struct FBMShotStreamArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FBMShotStreamEntry> shots;
+
+	ABMShooterShotStream* stream = nullptr;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& deltaParms) {
+		return FFastArraySerializer::FastArrayDeltaSerialize<FBMShotStreamEntry, FBMShotStreamArray>(shots, deltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FBMShotStreamArray> : public TStructOpsTypeTraitsBase2<FBMShotStreamArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/**
+ * Replicates projectile shots as small records on a single always relevant actor instead of one actor channel per
+ * projectile. The server flies each shot in UProjectileSimulationSubsystem and only sends where it ended, clients fly
+ * their own copy from the record, shown by the simulation. The owner of a predicted shot keeps its prediction if it is
+ * close enough to the server launch.
+ */
+UCLASS()
+class BMSHOOTER_API ABMShooterShotStream : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	ABMShooterShotStream();
+
+	virtual void PostInitializeComponents() override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/**
+	 * Server: launches a projectile shot and sends it to the clients.
+	 * @param clientShotId	Shot of the owning client this answers, so it can match it with its prediction
+	 */
+	void FireShot(TSubclassOf<ABMShooterProjectile> projectileClass, const FVector& origin, const FVector& direction, APawn* instigator, uint16 clientShotId);
+
+	// Counts a projectile shot launched by the server on either path, for bm.NetChannels
+	static void CountShot();
+
+	// true if projectile shots go through the stream instead of pooled actors
+	static bool IsEnabled();
+
+	// Client: flies the shot of a new entry, or keeps the owner's prediction of it flying
+	void OnShotAdded(const FBMShotStreamEntry& entry);
+
+	// Client: stops the local copy or the owner's prediction of a shot the server ended
+	void OnShotEnded(const FBMShotStreamEntry& entry);
+
+	// Seconds ended shots stay in the stream, so clients get the end before the entry goes away
+	UPROPERTY(EditDefaultsOnly, Category = Replication)
+	float endedShotLinger;
+
+protected:
+	// Server: marks the entry of a shot the simulation removed
+	void HandleShotEnded(uint32 shotId, const FVector& location);
+
+	UPROPERTY(Replicated)
+	FBMShotStreamArray shotArray;
+
+	UPROPERTY(Replicated)
+	TArray<TSubclassOf<ABMShooterProjectile>> projectileClasses;
+
+	uint32 lastShotId = 0;
+
+	// owner's predictions that continue a streamed shot, by server shot id, ended with it
+	TMap<uint32, TWeakObjectPtr<ABMShooterProjectile>> ownerPredictions;
+};
@@ -0,0 +1,42 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "HAL/LowLevelMemTracker.h"
+
+// stat BMShooter
+DECLARE_STATS_GROUP(TEXT("BMShooter"), STATGROUP_BMShooter, STATCAT_Advanced);
+
+// -csvCategories=BMShooter
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(BMSHOOTER_API, BMShooter);
+
+// Times the scope in stat BMShooter, in the BMShooter CSV category and as an Insights CPU event. Compiled out of shipping builds
+#define BM_SCOPE_CYCLE_COUNTER(StatName) \
+	SCOPE_CYCLE_COUNTER(StatName); \
+	CSV_SCOPED_TIMING_STAT(BMShooter, StatName); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(StatName)
+
+// Counts a call in stat BMShooter and in the BMShooter CSV category. Compiled out of shipping builds
+#define BM_COUNT_CALL(StatName) \
+	INC_DWORD_STAT(StatName); \
+	CSV_CUSTOM_STAT(BMShooter, StatName, 1, ECsvCustomStatOp::Accumulate)
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+// LLM tags of the module, run with -llm to see them in stat LLMFULL and in bm.MemReport
+enum class EBMLLMTag : int32
+{
+	Characters = (int32)ELLMTag::ProjectTagStart,
+	Projectiles,
+	Health,
+	Cosmetics,
+};
+
+// Tags the allocations of the scope, e.g. BM_LLM_SCOPE(Projectiles). Compiled out of builds without LLM
+#define BM_LLM_SCOPE(Tag) LLM_SCOPE((ELLMTag)EBMLLMTag::Tag)
+#else
+#define BM_LLM_SCOPE(Tag)
+#endif
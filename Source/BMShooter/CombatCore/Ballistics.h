@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// Projectile flight rules with no engine dependency, matching UProjectileMovementComponent for the settings the
+// projectiles use. Templated on the vector type so the simulation runs them on FVector directly, any type with
+// X, Y, Z members, + and * by a scalar works.
+
+#include <cmath>
+
+namespace BMCombat
+{
+	// Flight settings of a projectile class
+	struct FBallisticParams
+	{
+		float initialSpeed = 3000.0f;
+		float maxSpeed = 3000.0f;
+		float gravityZ = 0.0f;
+		bool bShouldBounce = true;
+		float bounciness = 0.6f;
+		float friction = 0.2f;
+		float bounceStopSpeed = 5.0f;
+	};
+
+	// Minimal vector for code that runs without the engine
+	struct FVec3
+	{
+		float X = 0.0f;
+		float Y = 0.0f;
+		float Z = 0.0f;
+
+		FVec3() {}
+		FVec3(float x, float y, float z) : X(x), Y(y), Z(z) {}
+
+		FVec3 operator+(const FVec3& other) const { return FVec3(X + other.X, Y + other.Y, Z + other.Z); }
+		FVec3 operator-(const FVec3& other) const { return FVec3(X - other.X, Y - other.Y, Z - other.Z); }
+		FVec3 operator*(float scale) const { return FVec3(X * scale, Y * scale, Z * scale); }
+		FVec3& operator+=(const FVec3& other) { X += other.X; Y += other.Y; Z += other.Z; return *this; }
+		FVec3& operator*=(float scale) { X *= scale; Y *= scale; Z *= scale; return *this; }
+	};
+
+	template<typename VectorType>
+	inline float Dot(const VectorType& a, const VectorType& b) {
+		return a.X * b.X + a.Y * b.Y + a.Z * b.Z;
+	}
+
+	// Applies gravity for deltaTime and clamps to maxSpeed, 0 for no limit
+	template<typename VectorType>
+	inline VectorType IntegrateVelocity(VectorType velocity, const FBallisticParams& params, float deltaTime) {
+		velocity.Z += params.gravityZ * deltaTime;
+
+		const float speedSquared = Dot(velocity, velocity);
+		if (params.maxSpeed > 0.0f && speedSquared > params.maxSpeed * params.maxSpeed) {
+			velocity *= params.maxSpeed / std::sqrt(speedSquared);
+		}
+		return velocity;
+	}
+
+	/**
+	 * Bounces off a surface like UProjectileMovementComponent::ComputeBounceDelta.
+	 * @return false if the projectile does not bounce or is too slow to keep flying
+	 */
+	template<typename VectorType>
+	inline bool ComputeBounce(const VectorType& velocity, const VectorType& normal, const FBallisticParams& params, VectorType& outVelocity) {
+		if (!params.bShouldBounce) {
+			return false;
+		}
+
+		outVelocity = velocity;
+		const float velocityDotNormal = Dot(velocity, normal);
+		if (velocityDotNormal < 0.0f) {
+			const VectorType projectedNormal = normal * -velocityDotNormal;
+			outVelocity += projectedNormal;
+			outVelocity *= std::fmin(std::fmax(1.0f - params.friction, 0.0f), 1.0f);
+			outVelocity += projectedNormal * std::fmax(params.bounciness, 0.0f);
+		}
+
+		return Dot(outVelocity, outVelocity) >= params.bounceStopSpeed * params.bounceStopSpeed;
+	}
+}
@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// Health, damage and respawn rules with no engine dependency, so they build and run outside the editor.
+// UHealthComponent, UCombatEventSubsystem and ABMShooterCharacter are adapters over these.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace BMCombat
+{
+	// health gets clamped between 0 and maxHealth
+	inline float ClampHealth(float health, float maxHealth) {
+		return std::min(std::max(health, 0.0f), maxHealth);
+	}
+
+	// health as a fraction of maxHealth over the full uint16 range
+	inline uint16_t QuantizeHealth(float health, float maxHealth) {
+		const float normalizedHealth = maxHealth > 0.0f ? std::min(std::max(health / maxHealth, 0.0f), 1.0f) : 0.0f;
+		return (uint16_t)std::lround(normalizedHealth * UINT16_MAX);
+	}
+
+	inline float DequantizeHealth(uint16_t quantizedHealth, float maxHealth) {
+		return maxHealth * quantizedHealth / (float)UINT16_MAX;
+	}
+
+	// A character dies the first time its health reaches 0
+	inline bool ShouldDie(float health, bool bAlreadyDead) {
+		return health <= 0.0f && !bAlreadyDead;
+	}
+
+	inline float GetRespawnTime(float deathTime, float respawnDelay) {
+		return deathTime + std::max(respawnDelay, 0.0f);
+	}
+
+	inline bool IsRespawnDue(float now, float respawnTime) {
+		return respawnTime <= now;
+	}
+
+	// Damage of one tick summed for a victim, the last hit decides who gets the credit
+	struct FDamageTotal
+	{
+		float damage = 0.0f;
+		int32_t numHits = 0;
+		int32_t lastHit = -1;
+	};
+
+	inline void AccumulateHit(FDamageTotal& total, float damage, int32_t hitIndex) {
+		total.damage += damage;
+		total.numHits++;
+		total.lastHit = hitIndex;
+	}
+
+	// Damage of an explosion, full up to innerRadius and falling off to minDamage at outerRadius
+	struct FRadialDamage
+	{
+		float baseDamage = 0.0f;
+		float minDamage = 0.0f;
+		float innerRadius = 0.0f;
+		float outerRadius = 0.0f;
+		// 1 is linear, higher drops off sooner past innerRadius
+		float falloff = 1.0f;
+	};
+
+	// Damage at distance from the center, 0 outside outerRadius
+	inline float GetRadialDamage(const FRadialDamage& radial, float distance) {
+		if (distance > radial.outerRadius) {
+			return 0.0f;
+		}
+		if (distance <= radial.innerRadius) {
+			return radial.baseDamage;
+		}
+
+		const float range = std::max(radial.outerRadius - radial.innerRadius, 1e-4f);
+		const float scale = std::pow(std::max(1.0f - (distance - radial.innerRadius) / range, 0.0f), std::max(radial.falloff, 0.0f));
+		return radial.minDamage + (radial.baseDamage - radial.minDamage) * scale;
+	}
+
+	struct FHit
+	{
+		int32_t victim = 0;
+		float damage = 0.0f;
+	};
+
+	/**
+	 * Sums hits per victim, victims keep the order of their first hit. Victims are indices below numVictims.
+	 * @param victimSlots	Scratch buffer, kept by the caller so resolving does not allocate
+	 */
+	inline void ResolveHits(const std::vector<FHit>& hits, int32_t numVictims, std::vector<int32_t>& victimSlots, std::vector<int32_t>& outVictims, std::vector<FDamageTotal>& outTotals) {
+		victimSlots.assign(numVictims, -1);
+		outVictims.clear();
+		outTotals.clear();
+
+		for (int32_t i = 0; i < (int32_t)hits.size(); i++) {
+			const FHit& hit = hits[i];
+			if (hit.victim < 0 || hit.victim >= numVictims) {
+				continue;
+			}
+
+			int32_t& slot = victimSlots[hit.victim];
+			if (slot < 0) {
+				slot = (int32_t)outTotals.size();
+				outVictims.push_back(hit.victim);
+				outTotals.emplace_back();
+			}
+			AccumulateHit(outTotals[slot], hit.damage, i);
+		}
+	}
+}
@@ -0,0 +1,225 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// Frame format of the replay ring buffer, with no engine dependency. A keyframe holds every value, a delta frame only
+// what changed since the frame before it, so a window of frames can only be decoded from its first keyframe on.
+// Values are varints, signed ones zigzag encoded, so small changes take a byte.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace BMCombat
+{
+	// State of a character in a frame, location in uu and view in 16 bit axes
+	struct FReplayCharacter
+	{
+		uint32_t id = 0;
+		int32_t x = 0;
+		int32_t y = 0;
+		int32_t z = 0;
+		uint16_t yaw = 0;
+		uint16_t pitch = 0;
+		uint16_t health = 0;
+		bool bDead = false;
+	};
+
+	struct FReplayProjectile
+	{
+		uint32_t id = 0;
+		int32_t x = 0;
+		int32_t y = 0;
+		int32_t z = 0;
+	};
+
+	// Entities are sorted by id, frames are matched with the previous one by walking both in order
+	struct FReplayFrame
+	{
+		uint32_t timeMs = 0;
+		std::vector<FReplayCharacter> characters;
+		std::vector<FReplayProjectile> projectiles;
+	};
+
+	inline void WriteVarInt(std::vector<uint8_t>& out, uint32_t value) {
+		while (value >= 0x80) {
+			out.push_back((uint8_t)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((uint8_t)value);
+	}
+
+	inline bool ReadVarInt(const uint8_t* data, size_t size, size_t& offset, uint32_t& outValue) {
+		outValue = 0;
+		for (int32_t shift = 0; shift < 35; shift += 7) {
+			if (offset >= size) {
+				return false;
+			}
+			const uint8_t byte = data[offset++];
+			outValue |= (uint32_t)(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline uint32_t ZigZag(int32_t value) {
+		return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+	}
+
+	inline int32_t UnZigZag(uint32_t value) {
+		return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+	}
+
+	// bits of the character fields written in a frame
+	enum EReplayCharacterField : uint8_t
+	{
+		ReplayX = 1 << 0,
+		ReplayY = 1 << 1,
+		ReplayZ = 1 << 2,
+		ReplayYaw = 1 << 3,
+		ReplayPitch = 1 << 4,
+		ReplayHealth = 1 << 5,
+		ReplayDead = 1 << 6,
+	};
+
+	// Base an entity is encoded against: the same id in the previous frame, or all zeroes
+	template<typename EntityType>
+	inline const EntityType& FindBase(const std::vector<EntityType>* previous, size_t& cursor, uint32_t id, const EntityType& zero) {
+		if (!previous) {
+			return zero;
+		}
+		while (cursor < previous->size() && (*previous)[cursor].id < id) {
+			cursor++;
+		}
+		return cursor < previous->size() && (*previous)[cursor].id == id ? (*previous)[cursor] : zero;
+	}
+
+	/**
+	 * Appends the frame to out, as a keyframe if previous is null.
+	 * Entities must be sorted by id in both frames.
+	 */
+	inline void EncodeFrame(const FReplayFrame& frame, const FReplayFrame* previous, std::vector<uint8_t>& out) {
+		out.push_back(previous ? 0 : 1);
+		WriteVarInt(out, previous ? frame.timeMs - previous->timeMs : frame.timeMs);
+
+		const FReplayCharacter zeroCharacter;
+		size_t cursor = 0;
+		WriteVarInt(out, (uint32_t)frame.characters.size());
+		for (const FReplayCharacter& character : frame.characters) {
+			const FReplayCharacter& base = FindBase(previous ? &previous->characters : nullptr, cursor, character.id, zeroCharacter);
+
+			uint8_t fields = 0;
+			fields |= character.x != base.x ? ReplayX : 0;
+			fields |= character.y != base.y ? ReplayY : 0;
+			fields |= character.z != base.z ? ReplayZ : 0;
+			fields |= character.yaw != base.yaw ? ReplayYaw : 0;
+			fields |= character.pitch != base.pitch ? ReplayPitch : 0;
+			fields |= character.health != base.health ? ReplayHealth : 0;
+			fields |= character.bDead != base.bDead ? ReplayDead : 0;
+
+			WriteVarInt(out, character.id);
+			out.push_back(fields);
+			if (fields & ReplayX) WriteVarInt(out, ZigZag(character.x - base.x));
+			if (fields & ReplayY) WriteVarInt(out, ZigZag(character.y - base.y));
+			if (fields & ReplayZ) WriteVarInt(out, ZigZag(character.z - base.z));
+			// view axes wrap around, the short way is the smaller number
+			if (fields & ReplayYaw) WriteVarInt(out, ZigZag((int16_t)(uint16_t)(character.yaw - base.yaw)));
+			if (fields & ReplayPitch) WriteVarInt(out, ZigZag((int16_t)(uint16_t)(character.pitch - base.pitch)));
+			if (fields & ReplayHealth) WriteVarInt(out, ZigZag(character.health - base.health));
+		}
+
+		const FReplayProjectile zeroProjectile;
+		cursor = 0;
+		WriteVarInt(out, (uint32_t)frame.projectiles.size());
+		for (const FReplayProjectile& projectile : frame.projectiles) {
+			const FReplayProjectile& base = FindBase(previous ? &previous->projectiles : nullptr, cursor, projectile.id, zeroProjectile);
+			WriteVarInt(out, projectile.id);
+			WriteVarInt(out, ZigZag(projectile.x - base.x));
+			WriteVarInt(out, ZigZag(projectile.y - base.y));
+			WriteVarInt(out, ZigZag(projectile.z - base.z));
+		}
+	}
+
+	/**
+	 * Reads the frame at offset, previous is the frame decoded before it and is ignored for keyframes.
+	 * @return false if the data is cut short or a delta frame has no previous frame
+	 */
+	inline bool DecodeFrame(const uint8_t* data, size_t size, size_t& offset, const FReplayFrame* previous, FReplayFrame& outFrame) {
+		if (offset >= size) {
+			return false;
+		}
+		const bool bKeyframe = data[offset++] != 0;
+		if (!bKeyframe && !previous) {
+			return false;
+		}
+		if (bKeyframe) {
+			previous = nullptr;
+		}
+
+		uint32_t time = 0;
+		if (!ReadVarInt(data, size, offset, time)) {
+			return false;
+		}
+		outFrame.timeMs = previous ? previous->timeMs + time : time;
+
+		uint32_t count = 0;
+		if (!ReadVarInt(data, size, offset, count)) {
+			return false;
+		}
+
+		const FReplayCharacter zeroCharacter;
+		size_t cursor = 0;
+		outFrame.characters.clear();
+		for (uint32_t i = 0; i < count; i++) {
+			uint32_t id = 0;
+			if (!ReadVarInt(data, size, offset, id) || offset >= size) {
+				return false;
+			}
+			const uint8_t fields = data[offset++];
+			FReplayCharacter character = FindBase(previous ? &previous->characters : nullptr, cursor, id, zeroCharacter);
+			character.id = id;
+
+			uint32_t value = 0;
+			if ((fields & ReplayX) && !ReadVarInt(data, size, offset, value)) return false;
+			character.x += (fields & ReplayX) ? UnZigZag(value) : 0;
+			if ((fields & ReplayY) && !ReadVarInt(data, size, offset, value)) return false;
+			character.y += (fields & ReplayY) ? UnZigZag(value) : 0;
+			if ((fields & ReplayZ) && !ReadVarInt(data, size, offset, value)) return false;
+			character.z += (fields & ReplayZ) ? UnZigZag(value) : 0;
+			if ((fields & ReplayYaw) && !ReadVarInt(data, size, offset, value)) return false;
+			character.yaw = (uint16_t)(character.yaw + ((fields & ReplayYaw) ? UnZigZag(value) : 0));
+			if ((fields & ReplayPitch) && !ReadVarInt(data, size, offset, value)) return false;
+			character.pitch = (uint16_t)(character.pitch + ((fields & ReplayPitch) ? UnZigZag(value) : 0));
+			if ((fields & ReplayHealth) && !ReadVarInt(data, size, offset, value)) return false;
+			character.health = (uint16_t)(character.health + ((fields & ReplayHealth) ? UnZigZag(value) : 0));
+			character.bDead = (fields & ReplayDead) ? !character.bDead : character.bDead;
+			outFrame.characters.push_back(character);
+		}
+
+		if (!ReadVarInt(data, size, offset, count)) {
+			return false;
+		}
+
+		const FReplayProjectile zeroProjectile;
+		cursor = 0;
+		outFrame.projectiles.clear();
+		for (uint32_t i = 0; i < count; i++) {
+			uint32_t id = 0;
+			uint32_t dx = 0;
+			uint32_t dy = 0;
+			uint32_t dz = 0;
+			if (!ReadVarInt(data, size, offset, id) || !ReadVarInt(data, size, offset, dx) || !ReadVarInt(data, size, offset, dy) || !ReadVarInt(data, size, offset, dz)) {
+				return false;
+			}
+			FReplayProjectile projectile = FindBase(previous ? &previous->projectiles : nullptr, cursor, id, zeroProjectile);
+			projectile.id = id;
+			projectile.x += UnZigZag(dx);
+			projectile.y += UnZigZag(dy);
+			projectile.z += UnZigZag(dz);
+			outFrame.projectiles.push_back(projectile);
+		}
+		return true;
+	}
+}
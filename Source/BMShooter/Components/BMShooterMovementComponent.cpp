@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BMShooterMovementComponent.h"
+#include "GameFramework/Character.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "LoadTest/BMLoadTestRecorder.h"
+#include "BMShooterStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Server Move Autonomous"), STAT_ServerMoveAutonomous, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Server Moves"), STAT_ServerMoves, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Server Move Corrections"), STAT_ServerMoveCorrections, STATGROUP_BMShooter);
+
+static TAutoConsoleVariable<int32> CVarMoveCompression(
+	TEXT("bm.MoveCompression"),
+	1,
+	TEXT("1: quantized moves, steady input send rate and correction tolerance, 0: stock character movement"));
+
+void FBMSavedMove::Clear() {
+	Super::Clear();
+	packedInput = 0;
+}
+
+void FBMSavedMove::SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData) {
+	// the client simulates the move with the acceleration it sends, so snapping it here costs no corrections.
+	// Input comes from the actor's forward and right vectors, snapping around its yaw keeps it exact and the steps
+	// the same while only the view turns
+	uint16 packedAccel = MAX_uint16;
+	const UBMShooterMovementComponent* movement = Cast<UBMShooterMovementComponent>(Character->GetCharacterMovement());
+	const FVector accel = movement ? movement->QuantizeAcceleration(NewAccel, Character->GetActorRotation().Yaw, packedAccel) : NewAccel;
+
+	Super::SetMoveFor(Character, InDeltaTime, accel, ClientData);
+
+	packedInput = (uint32)GetCompressedFlags() | (uint32)packedAccel << 8;
+}
+
+FBMNetworkPredictionData_Client::FBMNetworkPredictionData_Client(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement) {
+}
+
+FSavedMovePtr FBMNetworkPredictionData_Client::AllocateNewMove() {
+	return FSavedMovePtr(new FBMSavedMove());
+}
+
+UBMShooterMovementComponent::UBMShooterMovementComponent() {
+	BM_LLM_SCOPE(Characters);
+
+	accelHeadingSteps = 64;
+	accelMagnitudeSteps = 8;
+	steadyInputSendInterval = 1.0f / 30.0f;
+	correctionTolerance = 5.0f;
+}
+
+bool UBMShooterMovementComponent::IsMoveCompressionEnabled() {
+	return CVarMoveCompression.GetValueOnGameThread() != 0;
+}
+
+FNetworkPredictionData_Client* UBMShooterMovementComponent::GetPredictionData_Client() const {
+	if (!ClientPredictionData) {
+		UBMShooterMovementComponent* mutableThis = const_cast<UBMShooterMovementComponent*>(this);
+		mutableThis->ClientPredictionData = new FBMNetworkPredictionData_Client(*this);
+	}
+	return ClientPredictionData;
+}
+
+FVector UBMShooterMovementComponent::QuantizeAcceleration(const FVector& accel, float yaw, uint16& outPackedAccel) const {
+	outPackedAccel = MAX_uint16;
+
+	// flying and swimming input keeps the stock precision
+	if (!IsMoveCompressionEnabled() || !FMath::IsNearlyZero(accel.Z)) {
+		return accel;
+	}
+
+	const int32 headingSteps = FMath::Clamp(accelHeadingSteps, 8, 255);
+	const int32 magnitudeSteps = FMath::Clamp(accelMagnitudeSteps, 1, 255);
+	const float maxAcceleration = FMath::Max(GetMaxAcceleration(), KINDA_SMALL_NUMBER);
+
+	const int32 magnitudeStep = FMath::Clamp(FMath::RoundToInt(accel.Size2D() / maxAcceleration * magnitudeSteps), 0, magnitudeSteps);
+	if (magnitudeStep == 0) {
+		outPackedAccel = 0;
+		return FVector::ZeroVector;
+	}
+
+	const float yawRadians = FMath::DegreesToRadians(yaw);
+	const float heading = FMath::Atan2(accel.Y, accel.X) - yawRadians;
+	const int32 headingStep = ((FMath::RoundToInt(heading / (2.0f * PI) * headingSteps) % headingSteps) + headingSteps) % headingSteps;
+	outPackedAccel = (uint16)(headingStep << 8 | magnitudeStep);
+
+	float headingSin;
+	float headingCos;
+	FMath::SinCos(&headingSin, &headingCos, yawRadians + headingStep * 2.0f * PI / headingSteps);
+	return FVector(headingCos, headingSin, 0.0f) * (maxAcceleration * magnitudeStep / magnitudeSteps);
+}
+
+float UBMShooterMovementComponent::GetClientNetSendDeltaTime(const APlayerController* PC, const FNetworkPredictionData_Client_Character* ClientData, const FSavedMovePtr& NewMove) const {
+	const float sendDeltaTime = Super::GetClientNetSendDeltaTime(PC, ClientData, NewMove);
+	if (!IsMoveCompressionEnabled() || !NewMove.IsValid()) {
+		return sendDeltaTime;
+	}
+
+	// held input only needs the server to keep up, the moves in between combine into the pending one.
+	// A change of input still goes at the stock rate
+	const uint32 packedInput = static_cast<const FBMSavedMove*>(NewMove.Get())->packedInput;
+	const bool bSteadyInput = packedInput == lastPackedInput;
+	lastPackedInput = packedInput;
+
+	return bSteadyInput ? FMath::Max(sendDeltaTime, steadyInputSendInterval) : sendDeltaTime;
+}
+
+bool UBMShooterMovementComponent::ServerCheckClientError(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation, const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode) {
+	bool bNeedsCorrection;
+	if (!IsMoveCompressionEnabled()) {
+		bNeedsCorrection = Super::ServerCheckClientError(ClientTimeStamp, DeltaTime, Accel, ClientWorldLocation, RelativeClientLocation, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+	}
+	else if (PackNetworkMovementMode() != ClientMovementMode) {
+		bNeedsCorrection = true;
+	}
+	else {
+		// the server keeps its own position within the tolerance, the client's error can't pile up past it
+		const FVector locationError = UpdatedComponent->GetComponentLocation() - ClientWorldLocation;
+		bNeedsCorrection = locationError.SizeSquared() > FMath::Square(correctionTolerance);
+		bNetworkLargeClientCorrection |= bNeedsCorrection && locationError.Size() > NetworkLargeClientCorrectionDistance;
+	}
+
+	if (bNeedsCorrection) {
+		BM_COUNT_CALL(STAT_ServerMoveCorrections);
+		UBMLoadTestRecorder::CountMoveCorrection();
+	}
+	return bNeedsCorrection;
+}
+
+void UBMShooterMovementComponent::MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel) {
+	// clients replaying their moves after a correction don't count
+	if (!CharacterOwner || CharacterOwner->GetLocalRole() != ROLE_Authority) {
+		Super::MoveAutonomous(ClientTimeStamp, DeltaTime, CompressedFlags, NewAccel);
+		return;
+	}
+
+	BM_SCOPE_CYCLE_COUNTER(STAT_ServerMoveAutonomous);
+	BM_COUNT_CALL(STAT_ServerMoves);
+
+	const double startTime = FPlatformTime::Seconds();
+	Super::MoveAutonomous(ClientTimeStamp, DeltaTime, CompressedFlags, NewAccel);
+	UBMLoadTestRecorder::CountMove(FPlatformTime::Seconds() - startTime);
+}
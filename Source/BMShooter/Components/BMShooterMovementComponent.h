@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "BMShooterMovementComponent.generated.h"
+
+// A move with its acceleration snapped to the heading and magnitude steps of UBMShooterMovementComponent
+class FBMSavedMove : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	virtual void Clear() override;
+
+	virtual void SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData) override;
+
+	// compressed flags in the low byte and the acceleration steps above, equal for moves made with the same input
+	uint32 packedInput = 0;
+};
+
+class FBMNetworkPredictionData_Client : public FNetworkPredictionData_Client_Character
+{
+public:
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FBMNetworkPredictionData_Client(const UCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
+
+/**
+ * Character movement with cheaper moves. The client snaps its input acceleration to a few headings around the facing
+ * of the character and a few magnitudes, so moves made while holding the same input are identical and combine, and sends them at a lower rate while the
+ * input does not change. The server only corrects client positions further than correctionTolerance from its own.
+ * bm.MoveCompression 0 goes back to the stock behaviour.
+ */
+UCLASS()
+class BMSHOOTER_API UBMShooterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	UBMShooterMovementComponent();
+
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+
+	virtual float GetClientNetSendDeltaTime(const APlayerController* PC, const FNetworkPredictionData_Client_Character* ClientData, const FSavedMovePtr& NewMove) const override;
+
+	virtual bool ServerCheckClientError(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation, const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode) override;
+
+	/**
+	 * Snaps a planar acceleration to accelHeadingSteps headings around yaw and accelMagnitudeSteps fractions of the max
+	 * acceleration.
+	 * @param yaw				Facing of the character, input is relative to it so the same keys give the same steps
+	 * @param outPackedAccel	Heading step in the high byte and magnitude step in the low one, MAX_uint16 if it was not snapped
+	 */
+	FVector QuantizeAcceleration(const FVector& accel, float yaw, uint16& outPackedAccel) const;
+
+	static bool IsMoveCompressionEnabled();
+
+	/** Headings around the character's facing the input acceleration is snapped to, multiples of 8 keep the keyboard directions exact */
+	UPROPERTY(EditDefaultsOnly, Category = "Character Movement (Networking)", meta = (ClampMin = "8", ClampMax = "255"))
+	int32 accelHeadingSteps;
+
+	/** Fractions of the max acceleration the input acceleration is snapped to */
+	UPROPERTY(EditDefaultsOnly, Category = "Character Movement (Networking)", meta = (ClampMin = "1", ClampMax = "255"))
+	int32 accelMagnitudeSteps;
+
+	/** Seconds between moves sent while the input does not change, the stock send rate applies when it does */
+	UPROPERTY(EditDefaultsOnly, Category = "Character Movement (Networking)")
+	float steadyInputSendInterval;
+
+	/** Distance between the client and server positions the server lets go without a correction */
+	UPROPERTY(EditDefaultsOnly, Category = "Character Movement (Networking)")
+	float correctionTolerance;
+
+protected:
+	virtual void MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel) override;
+
+protected:
+	// input of the last move asked for its send time
+	mutable uint32 lastPackedInput = 0;
+};
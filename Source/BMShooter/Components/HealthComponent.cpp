@@ -4,15 +4,39 @@
 #include "HealthComponent.h"
 #include "Net/UnrealNetwork.h"
 #include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "BMShooterStats.h"
+#include "CombatCore/CombatRules.h"
+#include "Subsystems/HealthEffectSubsystem.h"
+#include "Engine/World.h"
+
+#if defined(WITH_PUSH_MODEL) && WITH_PUSH_MODEL
+#include "Net/Core/PushModel/PushModel.h"
+#endif
+
+DECLARE_CYCLE_STAT(TEXT("Health SetCurrentHealth"), STAT_SetCurrentHealth, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Health SetCurrentHealth Calls"), STAT_SetCurrentHealthCalls, STATGROUP_BMShooter);
+
+#if !UE_BUILD_SHIPPING
+static TAutoConsoleVariable<int32> CVarHealthDebug(
+	TEXT("bm.Health.Debug"),
+	0,
+	TEXT("Prints every health change on screen"),
+	ECVF_Cheat);
+#endif
 
 // Sets default values for this component's properties
 UHealthComponent::UHealthComponent() {
+	BM_LLM_SCOPE(Health);
+
 	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
 	// off to improve performance if you don't need them.
 	PrimaryComponentTick.bCanEverTick = false;
 
 	maxHealth = 100.0f;
+	regenRate = 0.0f;
 	currentHealth = 100.0f;
+	replicatedHealth = MAX_uint16;
 }
 
 
@@ -23,32 +47,54 @@ void UHealthComponent::BeginPlay() {
 	if (GetOwner()) {
 		GetOwner()->OnTakeAnyDamage.AddDynamic(this, &UHealthComponent::ReceiveDamage);
 	}
+
+	StartRegen();
+}
+
+void UHealthComponent::StartRegen() {
+	if (regenRate <= 0.0f || GetOwnerRole() != ROLE_Authority) {
+		return;
+	}
+
+	// ticked with the other health effects, paused while dead or at full health
+	UHealthEffectSubsystem* healthEffects = GetWorld()->GetSubsystem<UHealthEffectSubsystem>();
+	if (healthEffects) {
+		healthEffects->AddEffect(this, TEXT("Regen"), regenRate, 0.0f, nullptr, GetOwner());
+	}
 }
  
 void UHealthComponent::OnRep_CurrentHealth() {
-	//OnCurrentHealthUpdate();
+	currentHealth = DequantizeHealth(replicatedHealth);
+	OnCurrentHealthUpdate();
 }
 
 void UHealthComponent::OnCurrentHealthUpdate() {
-	// Server
-	if (GetOwnerRole() == ROLE_Authority)
-	{
-		FString healthMessage = FString::Printf(TEXT("%s now has %f health remaining."), *GetFName().ToString(), currentHealth);
-		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, healthMessage);
-	}
-
-	// Client
-	if (GetOwnerRole() == ROLE_AutonomousProxy && IsNetMode(NM_Client))
+#if !UE_BUILD_SHIPPING
+	if (CVarHealthDebug.GetValueOnGameThread() != 0 && GEngine)
 	{
-		FString healthMessage = FString::Printf(TEXT("You now have %f health remaining."), currentHealth);
-		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Blue, healthMessage);
+		// Server
+		if (GetOwnerRole() == ROLE_Authority)
+		{
+			FString healthMessage = FString::Printf(TEXT("%s now has %f health remaining."), *GetFName().ToString(), currentHealth);
+			GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, healthMessage);
+		}
+
+		// Client
+		if (GetOwnerRole() == ROLE_AutonomousProxy && IsNetMode(NM_Client))
+		{
+			FString healthMessage = FString::Printf(TEXT("You now have %f health remaining."), currentHealth);
+			GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Blue, healthMessage);
+		}
 	}
+#endif
 
 	// broadcast health modified event
 	OnHealthModifiedDelegate.Broadcast();
 }
 
 void UHealthComponent::ReceiveDamage(AActor* DamagedActor, float Damage, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser) {
+	lastInstigator = InstigatedBy;
+	lastDamageCauser = DamageCauser;
 	UHealthComponent::Damage(Damage);
 }
 
@@ -56,7 +102,13 @@ void UHealthComponent::GetLifetimeReplicatedProps(TArray <FLifetimeProperty>& Ou
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	//Replicate current health.
-	DOREPLIFETIME(UHealthComponent, currentHealth);
+#if defined(WITH_PUSH_MODEL) && WITH_PUSH_MODEL
+	FDoRepLifetimeParams params;
+	params.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UHealthComponent, replicatedHealth, params);
+#else
+	DOREPLIFETIME(UHealthComponent, replicatedHealth);
+#endif
 }
 
 float UHealthComponent::GetMaxHealth() const {
@@ -67,13 +119,32 @@ float UHealthComponent::GetCurrentHealth() const {
 	return currentHealth;
 }
 
+uint16 UHealthComponent::QuantizeHealth(float health) const {
+	return BMCombat::QuantizeHealth(health, maxHealth);
+}
+
+float UHealthComponent::DequantizeHealth(uint16 quantizedHealth) const {
+	return BMCombat::DequantizeHealth(quantizedHealth, maxHealth);
+}
+
 float UHealthComponent::GetNormalizedHealth() const {
 	return currentHealth / maxHealth; //normalize result
 }
 
 void UHealthComponent::SetCurrentHealth(float healthValue) {
+	BM_SCOPE_CYCLE_COUNTER(STAT_SetCurrentHealth);
+	BM_COUNT_CALL(STAT_SetCurrentHealthCalls);
+
 	if (GetOwnerRole() == ROLE_Authority) {
-		currentHealth = FMath::Clamp(healthValue, 0.f, maxHealth);
+		currentHealth = BMCombat::ClampHealth(healthValue, maxHealth);
+
+		const uint16 quantizedHealth = QuantizeHealth(currentHealth);
+		if (quantizedHealth != replicatedHealth) {
+			replicatedHealth = quantizedHealth;
+#if defined(WITH_PUSH_MODEL) && WITH_PUSH_MODEL
+			MARK_PROPERTY_DIRTY_FROM_NAME(UHealthComponent, replicatedHealth, this);
+#endif
+		}
 
 		// notify server of the update
 		OnCurrentHealthUpdate();  	
@@ -90,4 +161,5 @@ void UHealthComponent::Damage(float amount) {
 
 void UHealthComponent::ResetHealth() {
 	SetCurrentHealth(maxHealth);
+	StartRegen();
 }
\ No newline at end of file
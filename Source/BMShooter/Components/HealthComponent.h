@@ -47,6 +47,10 @@ public:
 	UFUNCTION(Category = Health)
 	void ResetHealth();
 
+	// controller and causer of the last damage received, server only
+	FORCEINLINE AController* GetLastInstigator() const { return lastInstigator.Get(); }
+	FORCEINLINE AActor* GetLastDamageCauser() const { return lastDamageCauser.Get(); }
+
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
@@ -58,16 +62,36 @@ protected:
 	// Called from server after currentHealth modification and from clients afetr repNotify 
 	void OnCurrentHealthUpdate();
 
+	// Server: registers the regen of this component with the health effects
+	void StartRegen();
+
+	// health as a fraction of maxHealth over the full uint16 range
+	uint16 QuantizeHealth(float health) const;
+
+	float DequantizeHealth(uint16 quantizedHealth) const;
+
 protected:
 	
 	// Max health of the character
 	UPROPERTY(EditDefaultsOnly, Category = Health)
 	float maxHealth;
 
-	// Current player's health
-	UPROPERTY(ReplicatedUsing = OnRep_CurrentHealth)
+	// Health recovered per second while alive, 0 to disable
+	UPROPERTY(EditDefaultsOnly, Category = Health)
+	float regenRate;
+
+	// Current player's health, exact on the server and rebuilt from replicatedHealth on clients
+	UPROPERTY()
 	float currentHealth;
 
+	// Quantized currentHealth, only written when the quantized value changes
+	UPROPERTY(ReplicatedUsing = OnRep_CurrentHealth)
+	uint16 replicatedHealth;
+
+	TWeakObjectPtr<AController> lastInstigator;
+
+	TWeakObjectPtr<AActor> lastDamageCauser;
+
 public:
 	//For notifying health modifications
 	UPROPERTY()
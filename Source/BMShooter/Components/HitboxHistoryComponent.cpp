@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HitboxHistoryComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/Character.h"
+#include "Engine/World.h"
+#include "Subsystems/LagCompensationSubsystem.h"
+
+// Sets default values for this component's properties
+UHitboxHistoryComponent::UHitboxHistoryComponent() {
+	// only ticks on the server, enabled in BeginPlay
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	// record where the capsule ended up this frame
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+}
+
+
+// Called when the game starts
+void UHitboxHistoryComponent::BeginPlay() {
+	Super::BeginPlay();
+
+	if (GetOwnerRole() != ROLE_Authority) {
+		return;
+	}
+
+	ULagCompensationSubsystem* lagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+	if (lagCompensation) {
+		sampleInterval = 1.0f / FMath::Max(lagCompensation->historySampleRate, 1.0f);
+
+		// enough snapshots to cover the whole window, plus one on each side to interpolate
+		const int32 capacity = FMath::CeilToInt(lagCompensation->maxRewindTime / sampleInterval) + 2;
+		history.SetNum(capacity);
+
+		lagCompensation->RegisterHitbox(this);
+		SetComponentTickEnabled(true);
+	}
+}
+
+void UHitboxHistoryComponent::EndPlay(const EEndPlayReason::Type EndPlayReason) {
+	ULagCompensationSubsystem* lagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+	if (lagCompensation) {
+		lagCompensation->UnregisterHitbox(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UHitboxHistoryComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) {
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const float now = GetWorld()->GetTimeSeconds();
+	if (numSnapshots == 0 || now - GetSnapshot(0).time >= sampleInterval) {
+		RecordSnapshot(now);
+	}
+}
+
+void UHitboxHistoryComponent::RecordSnapshot(float time) {
+	if (history.Num() == 0) {
+		return;
+	}
+
+	ACharacter* character = Cast<ACharacter>(GetOwner());
+	UCapsuleComponent* capsule = character ? character->GetCapsuleComponent() : nullptr;
+	if (!capsule) {
+		return;
+	}
+
+	newestIndex = (newestIndex + 1) % history.Num();
+	numSnapshots = FMath::Min(numSnapshots + 1, history.Num());
+
+	FHitboxSnapshot& snapshot = history[newestIndex];
+	snapshot.time = time;
+	snapshot.location = capsule->GetComponentLocation();
+	snapshot.rotation = capsule->GetComponentQuat();
+	snapshot.radius = capsule->GetScaledCapsuleRadius();
+	snapshot.halfHeight = capsule->GetScaledCapsuleHalfHeight();
+}
+
+bool UHitboxHistoryComponent::GetHitboxAtTime(float time, FHitboxSnapshot& outSnapshot) const {
+	if (numSnapshots == 0) {
+		return false;
+	}
+
+	// newer than the last snapshot, use it as is
+	if (time >= GetSnapshot(0).time) {
+		outSnapshot = GetSnapshot(0);
+		return true;
+	}
+
+	// walk back from the newest one, the buffer only holds a few hundred ms
+	for (int32 age = 1; age < numSnapshots; age++) {
+		const FHitboxSnapshot& older = GetSnapshot(age);
+		if (older.time <= time) {
+			const FHitboxSnapshot& newer = GetSnapshot(age - 1);
+			const float alpha = (time - older.time) / FMath::Max(newer.time - older.time, KINDA_SMALL_NUMBER);
+
+			outSnapshot.time = time;
+			outSnapshot.location = FMath::Lerp(older.location, newer.location, alpha);
+			outSnapshot.rotation = FQuat::Slerp(older.rotation, newer.rotation, alpha);
+			outSnapshot.radius = newer.radius;
+			outSnapshot.halfHeight = newer.halfHeight;
+			return true;
+		}
+	}
+
+	// older than the window, use the oldest snapshot
+	outSnapshot = GetSnapshot(numSnapshots - 1);
+	return true;
+}
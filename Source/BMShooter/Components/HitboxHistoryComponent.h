@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "HitboxHistoryComponent.generated.h"
+
+// Capsule of a character at a given server time
+struct FHitboxSnapshot
+{
+	float time = 0.0f;
+	FVector location = FVector::ZeroVector;
+	FQuat rotation = FQuat::Identity;
+	float radius = 0.0f;
+	float halfHeight = 0.0f;
+};
+
+/**
+ * Server side ring buffer of the owner's capsule transforms, used to rewind it for lag compensated hits.
+ * The buffer is sized once from the lag compensation settings, recording never allocates.
+ */
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class BMSHOOTER_API UHitboxHistoryComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:	
+	// Sets default values for this component's properties
+	UHitboxHistoryComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// Interpolated capsule at the given time, clamped to the recorded window. Returns false if nothing was recorded yet
+	bool GetHitboxAtTime(float time, FHitboxSnapshot& outSnapshot) const;
+
+	FORCEINLINE int32 GetNumSnapshots() const { return numSnapshots; }
+
+protected:
+	// Called when the game starts
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	void RecordSnapshot(float time);
+
+	// snapshot by age, 0 is the newest one
+	FORCEINLINE const FHitboxSnapshot& GetSnapshot(int32 age) const {
+		return history[(newestIndex - age + history.Num()) % history.Num()];
+	}
+
+protected:
+	TArray<FHitboxSnapshot> history;
+
+	int32 newestIndex = -1;
+
+	int32 numSnapshots = 0;
+
+	// seconds between two recorded snapshots
+	float sampleInterval = 0.0f;
+};
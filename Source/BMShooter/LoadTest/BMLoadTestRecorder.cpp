@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BMLoadTestRecorder.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectGlobals.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLoadTest, Log, All);
+
+int32 UBMLoadTestRecorder::secondRPCs = 0;
+int32 UBMLoadTestRecorder::secondMoves = 0;
+double UBMLoadTestRecorder::secondMoveTime = 0.0;
+int32 UBMLoadTestRecorder::secondMoveCorrections = 0;
+
+void UBMLoadTestRecorder::StartRecording(UWorld* world, int32 numBots, float duration) {
+	recordedWorld = world;
+	recordedBots = numBots;
+	runDuration = duration;
+	startTime = FPlatformTime::Seconds();
+	nextFlushTime = startTime + 1.0;
+
+	// no allocation while sampling, one second at 120 Hz and the whole run at 60 Hz
+	secondTickTimes.Reserve(120);
+	runTickTimes.Reserve(FMath::Max(FMath::CeilToInt(duration * 60.0f), 3600));
+
+	csvPath = FPaths::ProjectSavedDir() / TEXT("LoadTest") / FString::Printf(TEXT("LoadTest_%s.csv"), *FDateTime::Now().ToString());
+	csv = TEXT("time,connections,bots,tick_p50_ms,tick_p95_ms,tick_p99_ms,tick_max_ms,in_bytes_per_conn,out_bytes_per_conn,max_out_bytes_per_conn,rpcs,gc_ms,moves,move_ms,corrections\n");
+
+	preGarbageCollectHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddUObject(this, &UBMLoadTestRecorder::OnPreGarbageCollect);
+	postGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddUObject(this, &UBMLoadTestRecorder::OnPostGarbageCollect);
+
+	secondRPCs = 0;
+	secondMoves = 0;
+	secondMoveTime = 0.0;
+	secondMoveCorrections = 0;
+	bRecording = true;
+
+	UE_LOG(LogLoadTest, Log, TEXT("Load test recording started with %d bots, writing to %s"), numBots, *csvPath);
+}
+
+void UBMLoadTestRecorder::StopRecording() {
+	if (!bRecording) {
+		return;
+	}
+	bRecording = false;
+
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(preGarbageCollectHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(postGarbageCollectHandle);
+
+	// summary of the whole run
+	runTickTimes.Sort();
+	csv += FString::Printf(TEXT("total,,%d,%.3f,%.3f,%.3f,%.3f,,,,%d,%.3f,%d,%.3f,%d\n"), recordedBots,
+		GetPercentile(runTickTimes, 0.5f), GetPercentile(runTickTimes, 0.95f), GetPercentile(runTickTimes, 0.99f), GetPercentile(runTickTimes, 1.0f),
+		runRPCs, runGCTime, runMoves, runMoveTime, runMoveCorrections);
+
+	FFileHelper::SaveStringToFile(csv, *csvPath);
+	UE_LOG(LogLoadTest, Log, TEXT("Load test recording written to %s"), *csvPath);
+}
+
+void UBMLoadTestRecorder::CountRPC() {
+	secondRPCs++;
+}
+
+void UBMLoadTestRecorder::CountMove(double seconds) {
+	secondMoves++;
+	secondMoveTime += seconds;
+}
+
+void UBMLoadTestRecorder::CountMoveCorrection() {
+	secondMoveCorrections++;
+}
+
+bool UBMLoadTestRecorder::IsTickable() const {
+	return bRecording;
+}
+
+TStatId UBMLoadTestRecorder::GetStatId() const {
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBMLoadTestRecorder, STATGROUP_Tickables);
+}
+
+UWorld* UBMLoadTestRecorder::GetTickableGameObjectWorld() const {
+	return recordedWorld.Get();
+}
+
+void UBMLoadTestRecorder::Tick(float DeltaTime) {
+	// game thread time of the last frame, without the time spent waiting for the next server tick
+	const float tickTime = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	secondTickTimes.Add(tickTime);
+	runTickTimes.Add(tickTime);
+
+	const double now = FPlatformTime::Seconds();
+	if (now >= nextFlushTime) {
+		FlushSecond();
+		nextFlushTime += 1.0;
+	}
+
+	if (runDuration > 0.0f && now - startTime >= runDuration) {
+		StopRecording();
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UBMLoadTestRecorder::FlushSecond() {
+	int32 numConnections = 0;
+	int64 inBytes = 0;
+	int64 outBytes = 0;
+	int32 maxOutBytes = 0;
+
+	UWorld* world = recordedWorld.Get();
+	UNetDriver* netDriver = world ? world->GetNetDriver() : nullptr;
+	if (netDriver) {
+		for (UNetConnection* connection : netDriver->ClientConnections) {
+			if (!connection) {
+				continue;
+			}
+			numConnections++;
+			inBytes += connection->InBytesPerSecond;
+			outBytes += connection->OutBytesPerSecond;
+			maxOutBytes = FMath::Max(maxOutBytes, connection->OutBytesPerSecond);
+		}
+	}
+
+	secondTickTimes.Sort();
+	const float moveTime = (float)(secondMoveTime * 1000.0);
+	csv += FString::Printf(TEXT("%.0f,%d,%d,%.3f,%.3f,%.3f,%.3f,%lld,%lld,%d,%d,%.3f,%d,%.3f,%d\n"),
+		FPlatformTime::Seconds() - startTime, numConnections, recordedBots,
+		GetPercentile(secondTickTimes, 0.5f), GetPercentile(secondTickTimes, 0.95f), GetPercentile(secondTickTimes, 0.99f), GetPercentile(secondTickTimes, 1.0f),
+		numConnections > 0 ? inBytes / numConnections : 0, numConnections > 0 ? outBytes / numConnections : 0, maxOutBytes,
+		secondRPCs, secondGCTime, secondMoves, moveTime, secondMoveCorrections);
+
+	runRPCs += secondRPCs;
+	runMoves += secondMoves;
+	runMoveTime += moveTime;
+	runMoveCorrections += secondMoveCorrections;
+	secondRPCs = 0;
+	secondMoves = 0;
+	secondMoveTime = 0.0;
+	secondMoveCorrections = 0;
+	secondGCTime = 0.0f;
+	secondTickTimes.Reset();
+}
+
+void UBMLoadTestRecorder::OnPreGarbageCollect() {
+	gcStartTime = FPlatformTime::Seconds();
+}
+
+void UBMLoadTestRecorder::OnPostGarbageCollect() {
+	const float gcTime = (FPlatformTime::Seconds() - gcStartTime) * 1000.0f;
+	secondGCTime += gcTime;
+	runGCTime += gcTime;
+}
+
+float UBMLoadTestRecorder::GetPercentile(const TArray<float>& sortedValues, float percentile) {
+	if (sortedValues.Num() == 0) {
+		return 0.0f;
+	}
+	return sortedValues[FMath::Clamp(FMath::RoundToInt(percentile * (sortedValues.Num() - 1)), 0, sortedValues.Num() - 1)];
+}
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Tickable.h"
+#include "BMLoadTestRecorder.generated.h"
+
+/**
+ * Records server performance during a load test and writes it as a CSV in Saved/LoadTest.
+ * One row per second with game thread time percentiles, per connection bandwidth, RPCs, GC time and client moves,
+ * plus a summary row for the whole run.
+ */
+UCLASS()
+class BMSHOOTER_API UBMLoadTestRecorder : public UObject, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// Starts sampling the world, stops and exits after duration seconds if it is positive
+	void StartRecording(UWorld* world, int32 numBots, float duration);
+
+	// Writes the CSV, safe to call more than once
+	void StopRecording();
+
+	// Counts a server RPC received by this module
+	static void CountRPC();
+
+	// Counts a client move the server simulated and the time it took
+	static void CountMove(double seconds);
+
+	// Counts a correction sent to a client
+	static void CountMoveCorrection();
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+protected:
+	// Adds the row of the second that just ended
+	void FlushSecond();
+
+	void OnPreGarbageCollect();
+
+	void OnPostGarbageCollect();
+
+	static float GetPercentile(const TArray<float>& sortedValues, float percentile);
+
+protected:
+	TWeakObjectPtr<UWorld> recordedWorld;
+
+	FString csv;
+
+	FString csvPath;
+
+	// game thread times of the current second and of the whole run, in ms
+	TArray<float> secondTickTimes;
+	TArray<float> runTickTimes;
+
+	double startTime = 0.0;
+	double nextFlushTime = 0.0;
+	float runDuration = 0.0f;
+	int32 recordedBots = 0;
+
+	double gcStartTime = 0.0;
+	float secondGCTime = 0.0f;
+	float runGCTime = 0.0f;
+
+	int32 runRPCs = 0;
+	int32 runMoves = 0;
+	float runMoveTime = 0.0f;
+	int32 runMoveCorrections = 0;
+
+	FDelegateHandle preGarbageCollectHandle;
+	FDelegateHandle postGarbageCollectHandle;
+
+	bool bRecording = false;
+
+	static int32 secondRPCs;
+	static int32 secondMoves;
+	static double secondMoveTime;
+	static int32 secondMoveCorrections;
+};
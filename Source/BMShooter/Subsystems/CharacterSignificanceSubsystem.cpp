@@ -0,0 +1,254 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CharacterSignificanceSubsystem.h"
+#include "BMShooterCharacter.h"
+#include "BMShooterReplicationGraph.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+#include "DrawDebugHelpers.h"
+#include "HAL/IConsoleManager.h"
+#include "BMShooterStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Significance Update"), STAT_SignificanceUpdate, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Tier Changes"), STAT_SignificanceTierChanges, STATGROUP_BMShooter);
+
+static TAutoConsoleVariable<int32> CVarSignificance(
+	TEXT("bm.Significance"),
+	1,
+	TEXT("1: characters tick and replicate by significance tier, 0: every character at full rate"));
+
+#if !UE_BUILD_SHIPPING
+static TAutoConsoleVariable<int32> CVarSignificanceDebug(
+	TEXT("bm.Significance.Debug"),
+	0,
+	TEXT("Draws the significance tier of every character"));
+#endif
+
+UCharacterSignificanceSubsystem::UCharacterSignificanceSubsystem() {
+	updateInterval = 0.25f;
+	nearDistance = 1500.0f;
+	farDistance = 5000.0f;
+	serverViewFOV = 90.0f;
+	tierTickIntervals = { 0.0f, 0.033f, 0.1f, 0.25f };
+	tierNetPeriodFrames = { 1, 2, 4, 8 };
+}
+
+void UCharacterSignificanceSubsystem::Initialize(FSubsystemCollectionBase& Collection) {
+	Super::Initialize(Collection);
+	bInitialized = true;
+}
+
+void UCharacterSignificanceSubsystem::Deinitialize() {
+	bInitialized = false;
+	entries.Empty();
+	Super::Deinitialize();
+}
+
+bool UCharacterSignificanceSubsystem::IsTickable() const {
+	return bInitialized && entries.Num() > 0;
+}
+
+TStatId UCharacterSignificanceSubsystem::GetStatId() const {
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCharacterSignificanceSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UCharacterSignificanceSubsystem::GetTickableGameObjectWorld() const {
+	return GetWorld();
+}
+
+bool UCharacterSignificanceSubsystem::IsEnabled() {
+	return CVarSignificance.GetValueOnGameThread() != 0;
+}
+
+int32 UCharacterSignificanceSubsystem::GetNumTiers() const {
+	return FMath::Max(FMath::Min(tierTickIntervals.Num(), tierNetPeriodFrames.Num()), 1);
+}
+
+void UCharacterSignificanceSubsystem::RegisterCharacter(ABMShooterCharacter* character) {
+	if (!character || entries.ContainsByPredicate([character](const FSignificanceEntry& entry) { return entry.character == character; })) {
+		return;
+	}
+
+	FSignificanceEntry& entry = entries.AddDefaulted_GetRef();
+	entry.character = character;
+	entry.defaultAnimTickOption = character->GetMesh()->VisibilityBasedAnimTickOption;
+
+	// lets the engine also skip animation frames by screen size
+	if (!GetWorld()->IsNetMode(NM_DedicatedServer)) {
+		TInlineComponentArray<USkeletalMeshComponent*> meshes(character);
+		for (USkeletalMeshComponent* mesh : meshes) {
+			mesh->bEnableUpdateRateOptimizations = true;
+		}
+	}
+}
+
+int32 UCharacterSignificanceSubsystem::GetTier(const ABMShooterCharacter* character) const {
+	const FSignificanceEntry* entry = entries.FindByPredicate([character](const FSignificanceEntry& other) { return other.character == character; });
+	return entry ? entry->clientTier : 0;
+}
+
+int32 UCharacterSignificanceSubsystem::ComputeTier(const ABMShooterCharacter* character, const FVector& viewLocation, const FVector& viewDirection, float cosHalfFOV) const {
+	const FVector toCharacter = character->GetActorLocation() - viewLocation;
+	const float distSquared = toCharacter.SizeSquared();
+
+	int32 tier = 0;
+	if (distSquared > FMath::Square(farDistance)) {
+		tier = 2;
+	}
+	else if (distSquared > FMath::Square(nearDistance)) {
+		tier = 1;
+	}
+
+	// view cone test, widened by the character's radius so characters on the screen edge count as in view
+	const float dist = FMath::Sqrt(distSquared);
+	const float radius = character->GetSimpleCollisionRadius();
+	const bool bInView = dist <= radius || (toCharacter | viewDirection) >= dist * cosHalfFOV - radius;
+	if (!bInView) {
+		tier++;
+	}
+
+	if (character->characterDead) {
+		tier++;
+	}
+
+	return FMath::Min(tier, GetNumTiers() - 1);
+}
+
+void UCharacterSignificanceSubsystem::Tick(float DeltaTime) {
+	const bool bEnabled = IsEnabled();
+	if (!bEnabled && !bWasEnabled) {
+		return;
+	}
+
+	timeUntilUpdate -= DeltaTime;
+	if (timeUntilUpdate > 0.0f && bEnabled == bWasEnabled) {
+		return;
+	}
+	timeUntilUpdate = updateInterval;
+	bWasEnabled = bEnabled;
+
+	BM_SCOPE_CYCLE_COUNTER(STAT_SignificanceUpdate);
+
+	entries.RemoveAll([](const FSignificanceEntry& entry) { return !entry.character.IsValid(); });
+
+	UWorld* world = GetWorld();
+	if (!world->IsNetMode(NM_DedicatedServer)) {
+		UpdateClient();
+	}
+
+	UNetDriver* netDriver = world->GetNetDriver();
+	if (netDriver && netDriver->IsServer()) {
+		UpdateServer();
+	}
+
+#if !UE_BUILD_SHIPPING
+	DrawDebug();
+#endif
+}
+
+void UCharacterSignificanceSubsystem::UpdateClient() {
+	APlayerController* playerController = GetWorld()->GetFirstPlayerController();
+	if (!playerController) {
+		return;
+	}
+
+	FVector viewLocation;
+	FRotator viewRotation;
+	playerController->GetPlayerViewPoint(viewLocation, viewRotation);
+	const FVector viewDirection = viewRotation.Vector();
+
+	const float fov = playerController->PlayerCameraManager ? playerController->PlayerCameraManager->GetFOVAngle() : 90.0f;
+	const float cosHalfFOV = FMath::Cos(FMath::DegreesToRadians(fov * 0.5f));
+
+	const bool bEnabled = IsEnabled();
+	for (FSignificanceEntry& entry : entries) {
+		ABMShooterCharacter* character = entry.character.Get();
+
+		// only simulated proxies are throttled, the local character and the ones a listen server simulates itself
+		// (bots, remote players) drive movement, hit validation and animation notifies at full rate
+		const bool bFullRate = !bEnabled || character->GetLocalRole() != ROLE_SimulatedProxy;
+		const int32 tier = bFullRate ? 0 : ComputeTier(character, viewLocation, viewDirection, cosHalfFOV);
+		if (tier != entry.clientTier) {
+			ApplyClientTier(entry, tier);
+		}
+	}
+}
+
+void UCharacterSignificanceSubsystem::ApplyClientTier(FSignificanceEntry& entry, int32 tier) {
+	BM_COUNT_CALL(STAT_SignificanceTierChanges);
+
+	entry.clientTier = tier;
+	ABMShooterCharacter* character = entry.character.Get();
+
+	// the movement component keeps its full rate, simulated proxies need it to smooth the replicated moves
+	const float tickInterval = tierTickIntervals.IsValidIndex(tier) ? tierTickIntervals[tier] : 0.0f;
+	character->SetActorTickInterval(tickInterval);
+
+	// the least significant characters don't animate at all while off screen
+	const bool bLowestTier = tier > 0 && tier == GetNumTiers() - 1;
+	TInlineComponentArray<USkeletalMeshComponent*> meshes(character);
+	for (USkeletalMeshComponent* mesh : meshes) {
+		mesh->SetComponentTickInterval(tickInterval);
+		mesh->VisibilityBasedAnimTickOption = bLowestTier ? EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered : entry.defaultAnimTickOption;
+	}
+}
+
+void UCharacterSignificanceSubsystem::UpdateServer() {
+	UNetDriver* netDriver = GetWorld()->GetNetDriver();
+	const float cosHalfFOV = FMath::Cos(FMath::DegreesToRadians(serverViewFOV * 0.5f));
+	const bool bEnabled = IsEnabled();
+
+	for (const FSignificanceEntry& entry : entries) {
+		ABMShooterCharacter* character = entry.character.Get();
+
+		// fallback without the replication graph: one frequency for everyone, from the most significant view
+		int32 minPeriodFrames = MAX_int32;
+		bool bPerConnection = true;
+
+		for (UNetConnection* connection : netDriver->ClientConnections) {
+			APlayerController* viewer = connection ? connection->PlayerController : nullptr;
+			if (!viewer) {
+				continue;
+			}
+
+			int32 tier = 0;
+			if (bEnabled && viewer->GetPawn() != character) {
+				FVector viewLocation;
+				FRotator viewRotation;
+				viewer->GetPlayerViewPoint(viewLocation, viewRotation);
+				tier = ComputeTier(character, viewLocation, viewRotation.Vector(), cosHalfFOV);
+			}
+
+			const int32 periodFrames = FMath::Max(tierNetPeriodFrames.IsValidIndex(tier) ? tierNetPeriodFrames[tier] : 1, 1);
+			minPeriodFrames = FMath::Min(minPeriodFrames, periodFrames);
+			bPerConnection &= UBMShooterReplicationGraph::SetConnectionPeriodFrame(connection, character, (uint32)periodFrames);
+		}
+
+		if (!bPerConnection && minPeriodFrames != MAX_int32) {
+			const float defaultFrequency = character->GetClass()->GetDefaultObject<AActor>()->NetUpdateFrequency;
+			character->NetUpdateFrequency = defaultFrequency / minPeriodFrames;
+		}
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+void UCharacterSignificanceSubsystem::DrawDebug() const {
+	UWorld* world = GetWorld();
+	if (CVarSignificanceDebug.GetValueOnGameThread() == 0 || world->IsNetMode(NM_DedicatedServer)) {
+		return;
+	}
+
+	static const FColor tierColors[] = { FColor::Green, FColor::Yellow, FColor::Orange, FColor::Red };
+	for (const FSignificanceEntry& entry : entries) {
+		const ABMShooterCharacter* character = entry.character.Get();
+		const FColor color = tierColors[FMath::Min(entry.clientTier, (int32)ARRAY_COUNT(tierColors) - 1)];
+		const FVector location = character->GetActorLocation() + FVector(0.0f, 0.0f, character->GetSimpleCollisionHalfHeight() + 20.0f);
+		DrawDebugString(world, location, FString::Printf(TEXT("tier %d"), entry.clientTier), nullptr, color, updateInterval, true);
+	}
+}
+#endif
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "CharacterSignificanceSubsystem.generated.h"
+
+class ABMShooterCharacter;
+
+struct FSignificanceEntry
+{
+	TWeakObjectPtr<ABMShooterCharacter> character;
+	// tier applied on this client
+	int32 clientTier = 0;
+	// animation tick option of the mesh before significance changed it
+	EVisibilityBasedAnimTickOption defaultAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+};
+
+/**
+ * Sorts characters in significance tiers by distance to the viewer, whether they are in view and whether they are
+ * alive, tier 0 being the most significant. Clients slow down the ticking and animation of the simulated proxies in the
+ * low tiers, the server replicates them less often to the connections that see them as low tier.
+ */
+UCLASS(config=Game)
+class BMSHOOTER_API UCharacterSignificanceSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UCharacterSignificanceSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+	void RegisterCharacter(ABMShooterCharacter* character);
+
+	// Client tier of the character, 0 for unknown characters
+	int32 GetTier(const ABMShooterCharacter* character) const;
+
+	// true if significance is turned on with bm.Significance
+	static bool IsEnabled();
+
+	// Seconds between two updates of the tiers
+	UPROPERTY(config)
+	float updateInterval;
+
+	// Characters closer than this are in the top tier
+	UPROPERTY(config)
+	float nearDistance;
+
+	// Characters farther than this drop a tier
+	UPROPERTY(config)
+	float farDistance;
+
+	// Field of view the server assumes for its connections
+	UPROPERTY(config)
+	float serverViewFOV;
+
+	// Client actor and mesh tick interval of each tier, in seconds
+	UPROPERTY(config)
+	TArray<float> tierTickIntervals;
+
+	// Server frames between two replications of a character to a connection, per tier
+	UPROPERTY(config)
+	TArray<int32> tierNetPeriodFrames;
+
+protected:
+	int32 ComputeTier(const ABMShooterCharacter* character, const FVector& viewLocation, const FVector& viewDirection, float cosHalfFOV) const;
+
+	void UpdateClient();
+
+	void UpdateServer();
+
+	void ApplyClientTier(FSignificanceEntry& entry, int32 tier);
+
+	int32 GetNumTiers() const;
+
+#if !UE_BUILD_SHIPPING
+	void DrawDebug() const;
+#endif
+
+protected:
+	TArray<FSignificanceEntry> entries;
+
+	float timeUntilUpdate = 0.0f;
+
+	bool bWasEnabled = false;
+
+	bool bInitialized = false;
+};
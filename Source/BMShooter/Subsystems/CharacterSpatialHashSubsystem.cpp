@@ -0,0 +1,180 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CharacterSpatialHashSubsystem.h"
+#include "BMShooterCharacter.h"
+#include "Engine/World.h"
+#include "BMShooterStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Character Hash Update"), STAT_CharacterHashUpdate, STATGROUP_BMShooter);
+DECLARE_CYCLE_STAT(TEXT("Character Hash Query"), STAT_CharacterHashQuery, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character Hash Cell Moves"), STAT_CharacterHashCellMoves, STATGROUP_BMShooter);
+
+UCharacterSpatialHashSubsystem::UCharacterSpatialHashSubsystem() {
+	cellSize = 1000.0f;
+}
+
+void UCharacterSpatialHashSubsystem::Initialize(FSubsystemCollectionBase& Collection) {
+	Super::Initialize(Collection);
+	bInitialized = true;
+}
+
+void UCharacterSpatialHashSubsystem::Deinitialize() {
+	bInitialized = false;
+	characters.Empty();
+	locations.Empty();
+	characterCells.Empty();
+	inHash.Empty();
+	cells.Empty();
+	Super::Deinitialize();
+}
+
+bool UCharacterSpatialHashSubsystem::IsTickable() const {
+	return bInitialized && characters.Num() > 0;
+}
+
+TStatId UCharacterSpatialHashSubsystem::GetStatId() const {
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCharacterSpatialHashSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UCharacterSpatialHashSubsystem::GetTickableGameObjectWorld() const {
+	return GetWorld();
+}
+
+FIntPoint UCharacterSpatialHashSubsystem::GetCell(const FVector& location) const {
+	const float size = FMath::Max(cellSize, 1.0f);
+	return FIntPoint(FMath::FloorToInt(location.X / size), FMath::FloorToInt(location.Y / size));
+}
+
+void UCharacterSpatialHashSubsystem::GetCellRange(const FVector& location, float radius, FIntPoint& outMin, FIntPoint& outMax) const {
+	outMin = GetCell(location - FVector(radius, radius, 0.0f));
+	outMax = GetCell(location + FVector(radius, radius, 0.0f));
+}
+
+void UCharacterSpatialHashSubsystem::RegisterCharacter(ABMShooterCharacter* character) {
+	if (!character || characters.Contains(character)) {
+		return;
+	}
+
+	characters.Add(character);
+	locations.Add(character->GetActorLocation());
+	characterCells.Add(GetCell(locations.Last()));
+	inHash.Add(false);
+
+	if (!character->characterDead) {
+		AddToCell(characters.Num() - 1, characterCells.Last());
+	}
+}
+
+void UCharacterSpatialHashSubsystem::AddToCell(int32 slot, const FIntPoint& cell) {
+	cells.FindOrAdd(cell).Add(slot);
+	characterCells[slot] = cell;
+	inHash[slot] = true;
+}
+
+void UCharacterSpatialHashSubsystem::RemoveFromCell(int32 slot) {
+	TArray<int32>* cell = cells.Find(characterCells[slot]);
+	if (cell) {
+		cell->RemoveSingleSwap(slot, false);
+		if (cell->Num() == 0) {
+			cells.Remove(characterCells[slot]);
+		}
+	}
+	inHash[slot] = false;
+}
+
+void UCharacterSpatialHashSubsystem::RemoveSlot(int32 slot) {
+	if (inHash[slot]) {
+		RemoveFromCell(slot);
+	}
+
+	// the last slot takes this one's place, its cell list has to follow
+	const int32 lastSlot = characters.Num() - 1;
+	if (slot != lastSlot && inHash[lastSlot]) {
+		TArray<int32>& lastCell = cells.FindChecked(characterCells[lastSlot]);
+		lastCell[lastCell.IndexOfByKey(lastSlot)] = slot;
+	}
+
+	characters.RemoveAtSwap(slot, 1, false);
+	locations.RemoveAtSwap(slot, 1, false);
+	characterCells.RemoveAtSwap(slot, 1, false);
+	inHash.RemoveAtSwap(slot, 1, false);
+}
+
+void UCharacterSpatialHashSubsystem::Tick(float DeltaTime) {
+	BM_SCOPE_CYCLE_COUNTER(STAT_CharacterHashUpdate);
+
+	for (int32 slot = characters.Num() - 1; slot >= 0; slot--) {
+		const ABMShooterCharacter* character = characters[slot].Get();
+		if (!character) {
+			RemoveSlot(slot);
+			continue;
+		}
+
+		locations[slot] = character->GetActorLocation();
+
+		if (character->characterDead) {
+			if (inHash[slot]) {
+				RemoveFromCell(slot);
+			}
+			continue;
+		}
+
+		// most characters stay in their cell from one tick to the next
+		const FIntPoint cell = GetCell(locations[slot]);
+		if (!inHash[slot]) {
+			AddToCell(slot, cell);
+		}
+		else if (cell != characterCells[slot]) {
+			BM_COUNT_CALL(STAT_CharacterHashCellMoves);
+			RemoveFromCell(slot);
+			AddToCell(slot, cell);
+		}
+	}
+}
+
+void UCharacterSpatialHashSubsystem::QueryRadius(const FVector& location, float radius, TArray<ABMShooterCharacter*>& outCharacters) const {
+	BM_SCOPE_CYCLE_COUNTER(STAT_CharacterHashQuery);
+
+	FIntPoint minCell;
+	FIntPoint maxCell;
+	GetCellRange(location, radius, minCell, maxCell);
+
+	const float radiusSquared = FMath::Square(radius);
+	for (int32 x = minCell.X; x <= maxCell.X; x++) {
+		for (int32 y = minCell.Y; y <= maxCell.Y; y++) {
+			const TArray<int32>* cell = cells.Find(FIntPoint(x, y));
+			if (!cell) {
+				continue;
+			}
+
+			for (int32 slot : *cell) {
+				ABMShooterCharacter* character = characters[slot].Get();
+				if (character && FVector::DistSquared(location, locations[slot]) <= radiusSquared) {
+					outCharacters.Add(character);
+				}
+			}
+		}
+	}
+}
+
+float UCharacterSpatialHashSubsystem::ClosestDistSquared(const FVector& location, float radius) const {
+	FIntPoint minCell;
+	FIntPoint maxCell;
+	GetCellRange(location, radius, minCell, maxCell);
+
+	float closest = FMath::Square(radius);
+	for (int32 x = minCell.X; x <= maxCell.X; x++) {
+		for (int32 y = minCell.Y; y <= maxCell.Y; y++) {
+			const TArray<int32>* cell = cells.Find(FIntPoint(x, y));
+			if (!cell) {
+				continue;
+			}
+
+			for (int32 slot : *cell) {
+				closest = FMath::Min(closest, FVector::DistSquared(location, locations[slot]));
+			}
+		}
+	}
+	return closest;
+}
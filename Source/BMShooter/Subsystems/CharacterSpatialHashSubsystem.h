@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "CharacterSpatialHashSubsystem.generated.h"
+
+class ABMShooterCharacter;
+
+/**
+ * Server side 2D grid of the living characters. Every tick each character's cell is checked and the character only
+ * moves between cell lists when it crossed into another cell, dead characters are left out until they respawn.
+ * Radius queries only look at the cells the radius touches.
+ */
+UCLASS(config=Game)
+class BMSHOOTER_API UCharacterSpatialHashSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UCharacterSpatialHashSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+	// Server: tracks the character until it is destroyed
+	void RegisterCharacter(ABMShooterCharacter* character);
+
+	// Adds the living characters closer than radius to location, in 3D, to outCharacters
+	void QueryRadius(const FVector& location, float radius, TArray<ABMShooterCharacter*>& outCharacters) const;
+
+	// Squared distance to the closest living character within radius, or radius squared if there is none
+	float ClosestDistSquared(const FVector& location, float radius) const;
+
+	FORCEINLINE int32 GetNumCharacters() const { return characters.Num(); }
+
+	// Size of a grid cell, in uu
+	UPROPERTY(config)
+	float cellSize;
+
+protected:
+	FIntPoint GetCell(const FVector& location) const;
+
+	// Cell range touched by a radius around location
+	void GetCellRange(const FVector& location, float radius, FIntPoint& outMin, FIntPoint& outMax) const;
+
+	void AddToCell(int32 slot, const FIntPoint& cell);
+
+	void RemoveFromCell(int32 slot);
+
+	void RemoveSlot(int32 slot);
+
+protected:
+	// one entry per registered character in each array
+	TArray<TWeakObjectPtr<ABMShooterCharacter>> characters;
+	TArray<FVector> locations;
+	TArray<FIntPoint> characterCells;
+	TArray<bool> inHash;
+
+	// slots of the living characters in each cell
+	TMap<FIntPoint, TArray<int32>> cells;
+
+	bool bInitialized = false;
+};
@@ -0,0 +1,227 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatEventSubsystem.h"
+#include "BMShooterCharacter.h"
+#include "Components/HealthComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Subsystems/CharacterSpatialHashSubsystem.h"
+#include "Subsystems/CosmeticEventSubsystem.h"
+#include "GameFramework/Controller.h"
+#include "Engine/World.h"
+#include "BMShooterStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Combat Events Tick"), STAT_CombatEventsTick, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat Hits Queued"), STAT_CombatHitsQueued, STATGROUP_BMShooter);
+DECLARE_CYCLE_STAT(TEXT("Combat Radial Hit"), STAT_CombatRadialHit, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat Radial Traces"), STAT_CombatRadialTraces, STATGROUP_BMShooter);
+
+void UCombatEventSubsystem::Initialize(FSubsystemCollectionBase& Collection) {
+	Super::Initialize(Collection);
+	bInitialized = true;
+}
+
+void UCombatEventSubsystem::Deinitialize() {
+	bInitialized = false;
+	pendingHits.Empty();
+	pendingDeaths.Empty();
+	pendingRespawns.Empty();
+	radialCandidates.Empty();
+	Super::Deinitialize();
+}
+
+bool UCombatEventSubsystem::IsTickable() const {
+	return bInitialized && (pendingHits.Num() > 0 || pendingDeaths.Num() > 0 || pendingRespawns.Num() > 0);
+}
+
+TStatId UCombatEventSubsystem::GetStatId() const {
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatEventSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UCombatEventSubsystem::GetTickableGameObjectWorld() const {
+	return GetWorld();
+}
+
+void UCombatEventSubsystem::ApplyHit(UWorld* world, AActor* victim, float damage, AController* instigator, AActor* causer) {
+	if (!victim) {
+		return;
+	}
+
+	UCombatEventSubsystem* combatEvents = world ? world->GetSubsystem<UCombatEventSubsystem>() : nullptr;
+	if (combatEvents) {
+		combatEvents->QueueHit(victim, damage, instigator, causer);
+	}
+	else {
+		FDamageEvent damageEvent;
+		victim->TakeDamage(damage, damageEvent, instigator, causer);
+	}
+}
+
+void UCombatEventSubsystem::ApplyRadialHit(UWorld* world, const FVector& origin, const BMCombat::FRadialDamage& radial, AController* instigator, AActor* causer) {
+	BM_SCOPE_CYCLE_COUNTER(STAT_CombatRadialHit);
+
+	UCosmeticEventSubsystem::QueueEvent(world, EBMCosmeticType::Explosion, origin, FVector::UpVector, Cast<ABMShooterCharacter>(instigator ? instigator->GetPawn() : nullptr));
+
+	const UCharacterSpatialHashSubsystem* characterHash = world ? world->GetSubsystem<UCharacterSpatialHashSubsystem>() : nullptr;
+	if (!characterHash || radial.outerRadius <= 0.0f) {
+		return;
+	}
+
+	// the world's combat subsystem keeps the candidate buffer, hits are only queued below so it isn't reused mid loop
+	UCombatEventSubsystem* combatEvents = world->GetSubsystem<UCombatEventSubsystem>();
+	TArray<ABMShooterCharacter*> localCandidates;
+	TArray<ABMShooterCharacter*>& candidates = combatEvents ? combatEvents->radialCandidates : localCandidates;
+
+	// the margin covers the capsule radius and the tick the hash is behind, distances are checked again below
+	candidates.Reset();
+	characterHash->QueryRadius(origin, radial.outerRadius + 100.0f, candidates);
+	if (candidates.Num() == 0) {
+		return;
+	}
+
+	// only world geometry shields from the blast, one cheap test trace per candidate with shared params
+	FCollisionQueryParams traceParams(SCENE_QUERY_STAT(RadialHitOcclusion), false, causer);
+	const FCollisionObjectQueryParams occluders(ECC_WorldStatic);
+
+	for (ABMShooterCharacter* character : candidates) {
+		const FVector target = character->GetActorLocation();
+		const float radius = character->GetCapsuleComponent()->GetScaledCapsuleRadius();
+		const float damage = BMCombat::GetRadialDamage(radial, FMath::Max(FVector::Dist(origin, target) - radius, 0.0f));
+		if (damage <= 0.0f) {
+			continue;
+		}
+
+		BM_COUNT_CALL(STAT_CombatRadialTraces);
+		if (world->LineTraceTestByObjectType(origin, target, occluders, traceParams)) {
+			continue;
+		}
+
+		ApplyHit(world, character, damage, instigator, causer);
+	}
+}
+
+void UCombatEventSubsystem::QueueHit(AActor* victim, float damage, AController* instigator, AActor* causer) {
+	BM_COUNT_CALL(STAT_CombatHitsQueued);
+
+	FCombatHit& hit = pendingHits.AddDefaulted_GetRef();
+	hit.victim = victim;
+	hit.instigator = instigator;
+	hit.causer = causer;
+	hit.damage = damage;
+}
+
+void UCombatEventSubsystem::QueueDeath(ABMShooterCharacter* character) {
+	pendingDeaths.AddUnique(character);
+}
+
+void UCombatEventSubsystem::QueueRespawn(ABMShooterCharacter* character, float delay) {
+	FCombatRespawn& respawn = pendingRespawns.AddDefaulted_GetRef();
+	respawn.character = character;
+	respawn.respawnTime = BMCombat::GetRespawnTime(GetWorld()->GetTimeSeconds(), delay);
+}
+
+void UCombatEventSubsystem::Tick(float DeltaTime) {
+	BM_SCOPE_CYCLE_COUNTER(STAT_CombatEventsTick);
+
+	ResolveHits();
+	ResolveDeaths();
+	ResolveRespawns();
+}
+
+void UCombatEventSubsystem::ResolveHits() {
+	if (pendingHits.Num() == 0) {
+		return;
+	}
+
+	// victims get an index in the order of their first hit, the rules sum the damage per index
+	victimIndices.Reset();
+	victims.Reset();
+	hits.clear();
+	for (const FCombatHit& pendingHit : pendingHits) {
+		BMCombat::FHit hit;
+		hit.damage = pendingHit.damage;
+		hit.victim = INDEX_NONE;
+
+		AActor* victim = pendingHit.victim.Get();
+		if (victim) {
+			const int32* index = victimIndices.Find(victim);
+			hit.victim = index ? *index : victimIndices.Add(victim, victims.Add(victim));
+		}
+		hits.push_back(hit);
+	}
+
+	BMCombat::ResolveHits(hits, victims.Num(), victimSlots, resolvedVictims, resolvedTotals);
+
+	damageByVictim.Reset();
+	for (int32 i = 0; i < (int32)resolvedTotals.size(); i++) {
+		FCombatDamage& damage = damageByVictim.AddDefaulted_GetRef();
+		damage.victim = victims[resolvedVictims[i]];
+		damage.total = resolvedTotals[i];
+
+		const FCombatHit& lastHit = pendingHits[damage.total.lastHit];
+		damage.instigator = lastHit.instigator;
+		damage.causer = lastHit.causer;
+	}
+	pendingHits.Reset();
+
+	// one TakeDamage, so one health write and one delegate broadcast per victim
+	for (FCombatDamage& damage : damageByVictim) {
+		AActor* victim = damage.victim.Get();
+		if (!victim) {
+			continue;
+		}
+
+		// dead characters and the ones already waiting for the death pass take no damage and give no credit
+		ABMShooterCharacter* character = Cast<ABMShooterCharacter>(victim);
+		if (character && (character->characterDead || pendingDeaths.Contains(character))) {
+			continue;
+		}
+
+		// the delegate reports what the health lost, not the overkill
+		const UHealthComponent* health = victim->FindComponentByClass<UHealthComponent>();
+		const float healthBefore = health ? health->GetCurrentHealth() : 0.0f;
+
+		FDamageEvent damageEvent;
+		const float damageTaken = victim->TakeDamage(damage.total.damage, damageEvent, damage.instigator.Get(), damage.causer.Get());
+		damage.total.damage = health ? FMath::Max(healthBefore - health->GetCurrentHealth(), 0.0f) : damageTaken;
+		OnDamageApplied.Broadcast(damage);
+	}
+}
+
+void UCombatEventSubsystem::ResolveDeaths() {
+	for (const TWeakObjectPtr<ABMShooterCharacter>& deadCharacter : pendingDeaths) {
+		ABMShooterCharacter* character = deadCharacter.Get();
+		if (!character || character->characterDead) {
+			continue;
+		}
+
+		// the kill cam follows the killer's character, damage over time has no character as its causer
+		UHealthComponent* health = character->healthComponent;
+		AController* killerController = health ? health->GetLastInstigator() : nullptr;
+		character->killer = Cast<ABMShooterCharacter>(killerController ? killerController->GetPawn() : nullptr);
+
+		character->Die();
+		QueueRespawn(character, character->respawnTime);
+
+		OnKill.Broadcast(character, killerController, health ? health->GetLastDamageCauser() : nullptr);
+	}
+	pendingDeaths.Reset();
+}
+
+void UCombatEventSubsystem::ResolveRespawns() {
+	const float now = GetWorld()->GetTimeSeconds();
+
+	// removed in place so respawns due on the same tick keep their queue order
+	for (int32 i = 0; i < pendingRespawns.Num(); ) {
+		if (!BMCombat::IsRespawnDue(now, pendingRespawns[i].respawnTime)) {
+			i++;
+			continue;
+		}
+
+		ABMShooterCharacter* character = pendingRespawns[i].character.Get();
+		pendingRespawns.RemoveAt(i, 1, false);
+		if (character) {
+			character->RespawnCharacter();
+		}
+	}
+}
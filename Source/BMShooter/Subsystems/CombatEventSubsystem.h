@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "CombatCore/CombatRules.h"
+#include "CombatEventSubsystem.generated.h"
+
+class ABMShooterCharacter;
+
+// A hit waiting to be applied
+struct FCombatHit
+{
+	TWeakObjectPtr<AActor> victim;
+	TWeakObjectPtr<AController> instigator;
+	TWeakObjectPtr<AActor> causer;
+	float damage = 0.0f;
+};
+
+// Damage of one tick summed for a victim, the last hit decides who gets the credit
+struct FCombatDamage
+{
+	TWeakObjectPtr<AActor> victim;
+	TWeakObjectPtr<AController> instigator;
+	TWeakObjectPtr<AActor> causer;
+	BMCombat::FDamageTotal total;
+};
+
+struct FCombatRespawn
+{
+	TWeakObjectPtr<ABMShooterCharacter> character;
+	float respawnTime = 0.0f;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnCombatDamageApplied, const FCombatDamage& /*damage*/);
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnCombatKill, ABMShooterCharacter* /*victim*/, AController* /*killer*/, AActor* /*causer*/);
+
+/**
+ * Server side queue of combat events. Hits are recorded as they happen and resolved once per tick: damage is
+ * summed per victim so each one takes a single TakeDamage/health write, then deaths and respawns are processed
+ * in one pass, in the order they were queued.
+ */
+UCLASS()
+class BMSHOOTER_API UCombatEventSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+	// Queues the hit on the world's combat queue, or applies it right away if there is none
+	static void ApplyHit(UWorld* world, AActor* victim, float damage, AController* instigator, AActor* causer);
+
+	void QueueHit(AActor* victim, float damage, AController* instigator, AActor* causer);
+
+	// Server: damages the living characters around origin that world geometry does not shield, each one as a hit
+	static void ApplyRadialHit(UWorld* world, const FVector& origin, const BMCombat::FRadialDamage& radial, AController* instigator, AActor* causer);
+
+	// Kills the character in the next death pass
+	void QueueDeath(ABMShooterCharacter* character);
+
+	// Respawns the character after delay seconds
+	void QueueRespawn(ABMShooterCharacter* character, float delay);
+
+	// Damage applied to a living victim in a tick, summed over all its hits and capped to the health it lost
+	FOnCombatDamageApplied OnDamageApplied;
+
+	// A character died, killer is the controller of the last hit
+	FOnCombatKill OnKill;
+
+protected:
+	void ResolveHits();
+
+	void ResolveDeaths();
+
+	void ResolveRespawns();
+
+protected:
+	TArray<FCombatHit> pendingHits;
+
+	// scratch buffers kept between ticks so resolving does not allocate
+	TArray<FCombatDamage> damageByVictim;
+	TMap<AActor*, int32> victimIndices;
+	TArray<AActor*> victims;
+	std::vector<BMCombat::FHit> hits;
+	std::vector<int32_t> victimSlots;
+	std::vector<int32_t> resolvedVictims;
+	std::vector<BMCombat::FDamageTotal> resolvedTotals;
+
+	// scratch buffer of the radial hit candidates, reset on every query
+	UPROPERTY()
+	TArray<ABMShooterCharacter*> radialCandidates;
+
+	TArray<TWeakObjectPtr<ABMShooterCharacter>> pendingDeaths;
+
+	TArray<FCombatRespawn> pendingRespawns;
+
+	bool bInitialized = false;
+};
@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CosmeticEventSubsystem.h"
+#include "CosmeticFXSubsystem.h"
+#include "BMShooterCharacter.h"
+#include "BMShooterPlayerController.h"
+#include "Engine/World.h"
+#include "BMShooterStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Cosmetic Event Batching"), STAT_CosmeticEventBatching, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cosmetic Events Queued"), STAT_CosmeticEventsQueued, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cosmetic Events Sent"), STAT_CosmeticEventsSent, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cosmetic Batches Sent"), STAT_CosmeticBatchesSent, STATGROUP_BMShooter);
+
+UCosmeticEventSubsystem::UCosmeticEventSubsystem() {
+	relevancyDistance = 10000.0f;
+	maxEventsPerBatch = 32;
+}
+
+void UCosmeticEventSubsystem::Initialize(FSubsystemCollectionBase& Collection) {
+	Super::Initialize(Collection);
+	bInitialized = true;
+}
+
+void UCosmeticEventSubsystem::Deinitialize() {
+	bInitialized = false;
+	pendingEvents.Empty();
+	Super::Deinitialize();
+}
+
+bool UCosmeticEventSubsystem::IsTickable() const {
+	return bInitialized && pendingEvents.Num() > 0;
+}
+
+TStatId UCosmeticEventSubsystem::GetStatId() const {
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCosmeticEventSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UCosmeticEventSubsystem::GetTickableGameObjectWorld() const {
+	return GetWorld();
+}
+
+void UCosmeticEventSubsystem::QueueEvent(UWorld* world, EBMCosmeticType type, const FVector& location, const FVector& direction, ABMShooterCharacter* instigator, float length) {
+	if (!world || world->GetNetMode() == NM_Client) {
+		return;
+	}
+
+	UCosmeticEventSubsystem* cosmeticEvents = world->GetSubsystem<UCosmeticEventSubsystem>();
+	if (!cosmeticEvents) {
+		return;
+	}
+
+	BM_COUNT_CALL(STAT_CosmeticEventsQueued);
+
+	FBMCosmeticEvent& event = cosmeticEvents->pendingEvents.AddDefaulted_GetRef();
+	event.type = type;
+	event.location = location;
+	event.direction = direction;
+	event.length = (uint16)FMath::Clamp(FMath::RoundToInt(length), 0, (int32)MAX_uint16);
+	event.instigator = instigator;
+}
+
+void UCosmeticEventSubsystem::Tick(float DeltaTime) {
+	BM_SCOPE_CYCLE_COUNTER(STAT_CosmeticEventBatching);
+
+	// tickables run after the actors, so this frame's shots and hits are all queued by now
+	for (FConstPlayerControllerIterator it = GetWorld()->GetPlayerControllerIterator(); it; ++it) {
+		APlayerController* controller = it->Get();
+		if (!controller) {
+			continue;
+		}
+
+		// a listen server plays its own batch, remote players get theirs in one RPC
+		if (controller->IsLocalController()) {
+			GatherEvents(controller, batch);
+			UCosmeticFXSubsystem* cosmeticFX = GetWorld()->GetSubsystem<UCosmeticFXSubsystem>();
+			if (cosmeticFX && batch.Num() > 0) {
+				cosmeticFX->PlayEvents(batch);
+			}
+			continue;
+		}
+
+		ABMShooterPlayerController* shooterController = Cast<ABMShooterPlayerController>(controller);
+		if (!shooterController || !shooterController->GetNetConnection()) {
+			continue;
+		}
+
+		GatherEvents(controller, batch);
+		if (batch.Num() > 0) {
+			BM_COUNT_CALL(STAT_CosmeticBatchesSent);
+			INC_DWORD_STAT_BY(STAT_CosmeticEventsSent, batch.Num());
+			shooterController->ClientPlayCosmetics(batch);
+		}
+	}
+
+	pendingEvents.Reset();
+}
+
+void UCosmeticEventSubsystem::GatherEvents(APlayerController* controller, TArray<FBMCosmeticEvent>& outEvents) {
+	outEvents.Reset();
+	sortedEvents.Reset();
+
+	FVector viewLocation;
+	FRotator viewRotation;
+	controller->GetPlayerViewPoint(viewLocation, viewRotation);
+
+	const APawn* pawn = controller->GetPawn();
+	const float relevancyDistanceSquared = FMath::Square(relevancyDistance);
+	for (int32 i = 0; i < pendingEvents.Num(); i++) {
+		const FBMCosmeticEvent& event = pendingEvents[i];
+		if (event.type == EBMCosmeticType::Fire && event.instigator && event.instigator == pawn) {
+			continue;
+		}
+
+		const float distanceSquared = FVector::DistSquared(viewLocation, event.location);
+		if (distanceSquared <= relevancyDistanceSquared) {
+			sortedEvents.Emplace(distanceSquared, i);
+		}
+	}
+
+	// only a big firefight goes over the cap, the far events are the ones to go
+	if (sortedEvents.Num() > maxEventsPerBatch) {
+		sortedEvents.Sort([](const TPair<float, int32>& a, const TPair<float, int32>& b) {
+			return a.Key < b.Key;
+		});
+		sortedEvents.SetNum(FMath::Max(maxEventsPerBatch, 0), false);
+	}
+
+	for (const TPair<float, int32>& sortedEvent : sortedEvents) {
+		outEvents.Add(pendingEvents[sortedEvent.Value]);
+	}
+}
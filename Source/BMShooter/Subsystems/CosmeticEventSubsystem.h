@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Engine/NetSerialization.h"
+#include "CosmeticEventSubsystem.generated.h"
+
+class ABMShooterCharacter;
+
+UENUM()
+enum class EBMCosmeticType : uint8
+{
+	Fire,
+	Impact,
+	Explosion,
+	Num UMETA(Hidden)
+};
+
+// A fire, impact or explosion cosmetic as clients receive it
+USTRUCT()
+struct FBMCosmeticEvent
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	EBMCosmeticType type = EBMCosmeticType::Fire;
+
+	UPROPERTY()
+	FVector_NetQuantize location;
+
+	// direction of the shot for fire events, surface normal for impacts
+	UPROPERTY()
+	FVector_NetQuantizeNormal direction;
+
+	// fire events: uu from location to where the shot stopped
+	UPROPERTY()
+	uint16 length = 0;
+
+	// null if the character is not relevant to the receiving connection
+	UPROPERTY()
+	ABMShooterCharacter* instigator = nullptr;
+};
+
+/**
+ * Server side channel of the fire and impact cosmetics. Events produced during a frame are collected and sent at the
+ * end of it as one unreliable RPC per connection, holding only the events close enough to that player's view. A
+ * player's own shots are left out of its batch, it already played them when it fired. UCosmeticFXSubsystem plays them.
+ */
+UCLASS(config=Game)
+class BMSHOOTER_API UCosmeticEventSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UCosmeticEventSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+	// Server: queues a cosmetic on the world's channel, does nothing on clients
+	static void QueueEvent(UWorld* world, EBMCosmeticType type, const FVector& location, const FVector& direction, ABMShooterCharacter* instigator, float length = 0.0f);
+
+	// Max distance from a player's view of the events sent to it
+	UPROPERTY(config)
+	float relevancyDistance;
+
+	// Max events in one batch, the closest ones are kept
+	UPROPERTY(config)
+	int32 maxEventsPerBatch;
+
+protected:
+	// Events of this frame relevant to controller, closest first
+	void GatherEvents(APlayerController* controller, TArray<FBMCosmeticEvent>& outEvents);
+
+protected:
+	TArray<FBMCosmeticEvent> pendingEvents;
+
+	// scratch buffers kept between ticks so batching does not allocate
+	TArray<FBMCosmeticEvent> batch;
+	TArray<TPair<float, int32>> sortedEvents;
+
+	bool bInitialized = false;
+};
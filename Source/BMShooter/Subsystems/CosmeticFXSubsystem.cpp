@@ -0,0 +1,179 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CosmeticFXSubsystem.h"
+#include "BMShooterCharacter.h"
+#include "Animation/AnimInstance.h"
+#include "Animation/AnimMontage.h"
+#include "Components/AudioComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/AssetManager.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/GameplayStatics.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Sound/SoundBase.h"
+#include "BMShooterStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Cosmetic FX Play"), STAT_CosmeticFXPlay, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cosmetic FX Played"), STAT_CosmeticFXPlayed, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cosmetic FX Culled"), STAT_CosmeticFXCulled, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cosmetic FX Over Concurrency"), STAT_CosmeticFXOverConcurrency, STATGROUP_BMShooter);
+
+UCosmeticFXSubsystem::UCosmeticFXSubsystem() {
+	typeSettings.SetNum((int32)EBMCosmeticType::Num);
+	typeSettings[(int32)EBMCosmeticType::Fire].maxConcurrent = 8;
+	typeSettings[(int32)EBMCosmeticType::Fire].cullDistance = 6000.0f;
+	typeSettings[(int32)EBMCosmeticType::Impact].maxConcurrent = 12;
+	typeSettings[(int32)EBMCosmeticType::Impact].cullDistance = 4000.0f;
+	typeSettings[(int32)EBMCosmeticType::Explosion].maxConcurrent = 4;
+	typeSettings[(int32)EBMCosmeticType::Explosion].cullDistance = 10000.0f;
+}
+
+void UCosmeticFXSubsystem::Initialize(FSubsystemCollectionBase& Collection) {
+	Super::Initialize(Collection);
+
+	pools.SetNum((int32)EBMCosmeticType::Num);
+
+	// a dedicated server plays nothing, so it loads nothing either
+	UWorld* world = GetWorld();
+	if (!world || world->GetNetMode() == NM_DedicatedServer) {
+		return;
+	}
+
+	TArray<FSoftObjectPath> assets;
+	for (const FBMCosmeticTypeSettings& settings : typeSettings) {
+		if (!settings.sound.IsNull()) {
+			assets.AddUnique(settings.sound.ToSoftObjectPath());
+		}
+		if (!settings.effect.IsNull()) {
+			assets.AddUnique(settings.effect.ToSoftObjectPath());
+		}
+	}
+
+	if (assets.Num() > 0) {
+		BM_LLM_SCOPE(Cosmetics);
+		assetsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(assets);
+	}
+}
+
+void UCosmeticFXSubsystem::Deinitialize() {
+	pools.Empty();
+	assetsHandle.Reset();
+	Super::Deinitialize();
+}
+
+void UCosmeticFXSubsystem::PlayEvents(const TArray<FBMCosmeticEvent>& events) {
+	BM_SCOPE_CYCLE_COUNTER(STAT_CosmeticFXPlay);
+
+	APlayerController* localController = GetWorld()->GetFirstPlayerController();
+	if (!localController) {
+		return;
+	}
+
+	FVector viewLocation;
+	FRotator viewRotation;
+	localController->GetPlayerViewPoint(viewLocation, viewRotation);
+
+	for (const FBMCosmeticEvent& event : events) {
+		const int32 type = (int32)event.type;
+		if (!typeSettings.IsValidIndex(type) || !pools.IsValidIndex(type)) {
+			continue;
+		}
+
+		const FBMCosmeticTypeSettings& settings = typeSettings[type];
+		if (FVector::DistSquared(viewLocation, event.location) > FMath::Square(settings.cullDistance)) {
+			BM_COUNT_CALL(STAT_CosmeticFXCulled);
+			continue;
+		}
+
+		PlayEvent(event, settings, pools[type]);
+	}
+}
+
+void UCosmeticFXSubsystem::PlayEvent(const FBMCosmeticEvent& event, const FBMCosmeticTypeSettings& settings, FBMCosmeticPool& pool) {
+	BM_COUNT_CALL(STAT_CosmeticFXPlayed);
+
+	ABMShooterCharacter* character = event.type == EBMCosmeticType::Fire ? event.instigator : nullptr;
+
+	// the character's own sound if it is relevant here and streamed in
+	USoundBase* sound = character ? character->FireSound.Get() : nullptr;
+	if (!sound) {
+		sound = settings.sound.Get();
+	}
+
+	if (sound && !AcquireSound(pool, settings.maxConcurrent, sound, event.location)) {
+		BM_COUNT_CALL(STAT_CosmeticFXOverConcurrency);
+	}
+
+	UParticleSystem* effect = settings.effect.Get();
+	if (effect && !AcquireEffect(pool, settings.maxConcurrent, effect, event.location, FVector(event.direction).Rotation())) {
+		BM_COUNT_CALL(STAT_CosmeticFXOverConcurrency);
+	}
+
+	if (character) {
+		UAnimMontage* fireAnimation = character->GetTPFireAnimation();
+		UAnimInstance* animInstance = character->GetMesh()->GetAnimInstance();
+		if (fireAnimation && animInstance) {
+			animInstance->Montage_Play(fireAnimation, 1.0f);
+		}
+
+		const FVector start = event.location;
+		character->RemoteShotFired(start, start + FVector(event.direction) * event.length);
+	}
+}
+
+UAudioComponent* UCosmeticFXSubsystem::AcquireSound(FBMCosmeticPool& pool, int32 maxConcurrent, USoundBase* sound, const FVector& location) {
+	pool.sounds.RemoveAllSwap([](UAudioComponent* component) {
+		return !IsValid(component);
+	});
+
+	for (UAudioComponent* component : pool.sounds) {
+		if (!component->IsPlaying()) {
+			component->SetSound(sound);
+			component->SetWorldLocation(location);
+			component->Play();
+			return component;
+		}
+	}
+
+	if (pool.sounds.Num() >= maxConcurrent) {
+		return nullptr;
+	}
+
+	BM_LLM_SCOPE(Cosmetics);
+	UAudioComponent* component = UGameplayStatics::SpawnSoundAtLocation(this, sound, location, FRotator::ZeroRotator, 1.0f, 1.0f, 0.0f, nullptr, nullptr, false);
+	if (component) {
+		pool.sounds.Add(component);
+	}
+	return component;
+}
+
+UParticleSystemComponent* UCosmeticFXSubsystem::AcquireEffect(FBMCosmeticPool& pool, int32 maxConcurrent, UParticleSystem* effect, const FVector& location, const FRotator& rotation) {
+	pool.effects.RemoveAllSwap([](UParticleSystemComponent* component) {
+		return !IsValid(component);
+	});
+
+	for (UParticleSystemComponent* component : pool.effects) {
+		if (!component->IsActive() || component->HasCompleted()) {
+			if (component->Template != effect) {
+				component->SetTemplate(effect);
+			}
+			component->SetWorldLocationAndRotation(location, rotation);
+			component->ActivateSystem(true);
+			return component;
+		}
+	}
+
+	if (pool.effects.Num() >= maxConcurrent) {
+		return nullptr;
+	}
+
+	BM_LLM_SCOPE(Cosmetics);
+	UParticleSystemComponent* component = UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), effect, location, rotation, FVector(1.0f), false);
+	if (component) {
+		pool.effects.Add(component);
+	}
+	return component;
+}
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/StreamableManager.h"
+#include "CosmeticEventSubsystem.h"
+#include "CosmeticFXSubsystem.generated.h"
+
+class UAudioComponent;
+class UParticleSystem;
+class UParticleSystemComponent;
+class USoundBase;
+
+// How one type of cosmetic is played
+USTRUCT()
+struct FBMCosmeticTypeSettings
+{
+	GENERATED_BODY()
+
+	// played when the event brings none of its own, e.g. fire events of a character that is not relevant
+	UPROPERTY()
+	TSoftObjectPtr<USoundBase> sound;
+
+	UPROPERTY()
+	TSoftObjectPtr<UParticleSystem> effect;
+
+	// sounds and effects of this type playing at once, the pools never grow past it
+	UPROPERTY()
+	int32 maxConcurrent = 8;
+
+	// events further than this from the camera are not played
+	UPROPERTY()
+	float cullDistance = 5000.0f;
+};
+
+// Components of one type of cosmetic, reused once they finish playing
+USTRUCT()
+struct FBMCosmeticPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<UAudioComponent*> sounds;
+
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> effects;
+};
+
+/**
+ * Client side player of the cosmetic batches sent by UCosmeticEventSubsystem. Each type of cosmetic has a pool of audio
+ * and particle components capped at maxConcurrent, an event finding all of them busy is dropped instead of starting
+ * another instance. Events too far from the camera are dropped before that.
+ */
+UCLASS(config=Game)
+class BMSHOOTER_API UCosmeticFXSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UCosmeticFXSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	void PlayEvents(const TArray<FBMCosmeticEvent>& events);
+
+	// Indexed by EBMCosmeticType
+	UPROPERTY(config)
+	TArray<FBMCosmeticTypeSettings> typeSettings;
+
+protected:
+	void PlayEvent(const FBMCosmeticEvent& event, const FBMCosmeticTypeSettings& settings, FBMCosmeticPool& pool);
+
+	// A finished component of the pool, or a new one while it is under maxConcurrent. Null if they are all busy
+	UAudioComponent* AcquireSound(FBMCosmeticPool& pool, int32 maxConcurrent, USoundBase* sound, const FVector& location);
+
+	UParticleSystemComponent* AcquireEffect(FBMCosmeticPool& pool, int32 maxConcurrent, UParticleSystem* effect, const FVector& location, const FRotator& rotation);
+
+protected:
+	UPROPERTY()
+	TArray<FBMCosmeticPool> pools;
+
+	TSharedPtr<FStreamableHandle> assetsHandle;
+};
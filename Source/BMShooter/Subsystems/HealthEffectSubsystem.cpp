@@ -0,0 +1,228 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HealthEffectSubsystem.h"
+#include "Subsystems/CombatEventSubsystem.h"
+#include "Components/HealthComponent.h"
+#include "Engine/World.h"
+#include "BMShooterStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Health Effects Step"), STAT_HealthEffectsStep, STATGROUP_BMShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Health Effects"), STAT_HealthEffects, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Health Effect Writes"), STAT_HealthEffectWrites, STATGROUP_BMShooter);
+
+UHealthEffectSubsystem::UHealthEffectSubsystem() {
+	stepRate = 10.0f;
+	maxStepsPerTick = 4;
+}
+
+void UHealthEffectSubsystem::Initialize(FSubsystemCollectionBase& Collection) {
+	Super::Initialize(Collection);
+	bInitialized = true;
+}
+
+void UHealthEffectSubsystem::Deinitialize() {
+	bInitialized = false;
+	handles.Empty();
+	effectTargets.Empty();
+	effectNames.Empty();
+	rates.Empty();
+	remainingTimes.Empty();
+	instigators.Empty();
+	causers.Empty();
+	targets.Empty();
+	targetEffectCounts.Empty();
+	SET_DWORD_STAT(STAT_HealthEffects, 0);
+	Super::Deinitialize();
+}
+
+bool UHealthEffectSubsystem::IsTickable() const {
+	return bInitialized && handles.Num() > 0;
+}
+
+TStatId UHealthEffectSubsystem::GetStatId() const {
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHealthEffectSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UHealthEffectSubsystem::GetTickableGameObjectWorld() const {
+	return GetWorld();
+}
+
+int32 UHealthEffectSubsystem::GetOrAddTarget(UHealthComponent* target) {
+	// a handful of targets, a linear search over the table is cheaper than a map
+	int32 targetIndex = targets.IndexOfByKey(target);
+	if (targetIndex == INDEX_NONE) {
+		targetIndex = targets.Add(target);
+		targetEffectCounts.Add(0);
+	}
+	return targetIndex;
+}
+
+int32 UHealthEffectSubsystem::FindEffect(int32 targetIndex, FName effectName, const AActor* causer) const {
+	for (int32 i = 0; i < handles.Num(); i++) {
+		if (effectTargets[i] == targetIndex && effectNames[i] == effectName && causers[i].Get() == causer) {
+			return i;
+		}
+	}
+	return INDEX_NONE;
+}
+
+uint32 UHealthEffectSubsystem::AddEffect(UHealthComponent* target, FName effectName, float ratePerSecond, float duration, AController* instigator, AActor* causer) {
+	if (!target || GetWorld()->IsNetMode(NM_Client)) {
+		return 0;
+	}
+
+	// effects that last until removed never run out
+	const float remainingTime = duration > 0.0f ? duration : MAX_flt;
+
+	const int32 targetIndex = GetOrAddTarget(target);
+	const int32 existing = FindEffect(targetIndex, effectName, causer);
+	if (existing != INDEX_NONE) {
+		rates[existing] = ratePerSecond;
+		remainingTimes[existing] = remainingTime;
+		instigators[existing] = instigator;
+		return handles[existing];
+	}
+
+	// 0 means no effect
+	lastHandle = lastHandle == MAX_uint32 ? 1 : lastHandle + 1;
+
+	handles.Add(lastHandle);
+	effectTargets.Add(targetIndex);
+	effectNames.Add(effectName);
+	rates.Add(ratePerSecond);
+	remainingTimes.Add(remainingTime);
+	instigators.Add(instigator);
+	causers.Add(causer);
+	targetEffectCounts[targetIndex]++;
+
+	SET_DWORD_STAT(STAT_HealthEffects, handles.Num());
+	return lastHandle;
+}
+
+void UHealthEffectSubsystem::RemoveEffect(uint32 handle) {
+	const int32 index = handles.IndexOfByKey(handle);
+	if (index != INDEX_NONE) {
+		RemoveEffectAt(index);
+	}
+}
+
+void UHealthEffectSubsystem::RemoveEffect(UHealthComponent* target, FName effectName, AActor* causer) {
+	const int32 targetIndex = targets.IndexOfByKey(target);
+	const int32 index = targetIndex != INDEX_NONE ? FindEffect(targetIndex, effectName, causer) : INDEX_NONE;
+	if (index != INDEX_NONE) {
+		RemoveEffectAt(index);
+	}
+}
+
+void UHealthEffectSubsystem::RemoveEffects(UHealthComponent* target) {
+	const int32 targetIndex = targets.IndexOfByKey(target);
+	if (targetIndex == INDEX_NONE) {
+		return;
+	}
+
+	for (int32 i = handles.Num() - 1; i >= 0; i--) {
+		if (effectTargets[i] == targetIndex) {
+			RemoveEffectAt(i);
+		}
+	}
+}
+
+void UHealthEffectSubsystem::RemoveEffectAt(int32 index) {
+	targetEffectCounts[effectTargets[index]]--;
+
+	handles.RemoveAtSwap(index, 1, false);
+	effectTargets.RemoveAtSwap(index, 1, false);
+	effectNames.RemoveAtSwap(index, 1, false);
+	rates.RemoveAtSwap(index, 1, false);
+	remainingTimes.RemoveAtSwap(index, 1, false);
+	instigators.RemoveAtSwap(index, 1, false);
+	causers.RemoveAtSwap(index, 1, false);
+
+	SET_DWORD_STAT(STAT_HealthEffects, handles.Num());
+}
+
+void UHealthEffectSubsystem::Tick(float DeltaTime) {
+	const float stepTime = 1.0f / FMath::Max(stepRate, 1.0f);
+
+	// whatever is left over after maxStepsPerTick is dropped
+	stepAccumulator = FMath::Min(stepAccumulator + DeltaTime, stepTime * maxStepsPerTick);
+	while (stepAccumulator >= stepTime && handles.Num() > 0) {
+		stepAccumulator -= stepTime;
+		Step(stepTime);
+	}
+}
+
+void UHealthEffectSubsystem::Step(float stepTime) {
+	BM_SCOPE_CYCLE_COUNTER(STAT_HealthEffectsStep);
+
+	const int32 numTargets = targets.Num();
+	targetDeltas.Reset();
+	targetDeltas.AddZeroed(numTargets);
+	targetDamageEffects.Reset();
+	targetDamageEffects.Init(INDEX_NONE, numTargets);
+
+	// sum the effects per target, the strongest damage effect credits the damage
+	for (int32 i = 0; i < handles.Num(); i++) {
+		const float appliedTime = FMath::Min(stepTime, remainingTimes[i]);
+		remainingTimes[i] -= stepTime;
+
+		const int32 targetIndex = effectTargets[i];
+		targetDeltas[targetIndex] += rates[i] * appliedTime;
+
+		const int32 damageEffect = targetDamageEffects[targetIndex];
+		if (rates[i] < 0.0f && (damageEffect == INDEX_NONE || rates[i] < rates[damageEffect])) {
+			targetDamageEffects[targetIndex] = i;
+		}
+	}
+
+	// one health write per target
+	UWorld* world = GetWorld();
+	for (int32 targetIndex = 0; targetIndex < numTargets; targetIndex++) {
+		UHealthComponent* health = targets[targetIndex].Get();
+		if (!health) {
+			continue;
+		}
+
+		// dead targets wait for their respawn, full ones have nothing to heal
+		const float delta = targetDeltas[targetIndex];
+		const float currentHealth = health->GetCurrentHealth();
+		if (currentHealth <= 0.0f || delta == 0.0f || (delta > 0.0f && currentHealth >= health->GetMaxHealth())) {
+			continue;
+		}
+
+		BM_COUNT_CALL(STAT_HealthEffectWrites);
+		if (delta > 0.0f) {
+			health->Heal(delta);
+		}
+		else {
+			const int32 damageEffect = targetDamageEffects[targetIndex];
+			UCombatEventSubsystem::ApplyHit(world, health->GetOwner(), -delta, instigators[damageEffect].Get(), causers[damageEffect].Get());
+		}
+	}
+
+	// drop finished effects and effects on destroyed targets
+	for (int32 i = handles.Num() - 1; i >= 0; i--) {
+		if (remainingTimes[i] <= 0.0f || !targets[effectTargets[i]].IsValid()) {
+			RemoveEffectAt(i);
+		}
+	}
+
+	// compact the target table so it only holds targets with effects
+	for (int32 targetIndex = targets.Num() - 1; targetIndex >= 0; targetIndex--) {
+		if (targetEffectCounts[targetIndex] > 0) {
+			continue;
+		}
+
+		const int32 lastIndex = targets.Num() - 1;
+		if (targetIndex != lastIndex) {
+			for (int32& effectTarget : effectTargets) {
+				if (effectTarget == lastIndex) {
+					effectTarget = targetIndex;
+				}
+			}
+		}
+		targets.RemoveAtSwap(targetIndex, 1, false);
+		targetEffectCounts.RemoveAtSwap(targetIndex, 1, false);
+	}
+}
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "HealthEffectSubsystem.generated.h"
+
+class UHealthComponent;
+
+/**
+ * Server side health over time: poison, burning, regen, heal zones. Effects are kept in parallel arrays and applied
+ * at a fixed rate in one pass, the rates of all the effects on a target are summed so each step writes its health
+ * once. Damage goes through the combat queue so kills and stats are credited like any other hit.
+ */
+UCLASS(config=Game)
+class BMSHOOTER_API UHealthEffectSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UHealthEffectSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+	/**
+	 * Changes the target's health by ratePerSecond (negative for damage) for duration seconds, or until removed if
+	 * duration is not positive. Adding an effect with the same name and causer again restarts it instead of stacking.
+	 * @return handle of the effect, 0 on clients
+	 */
+	uint32 AddEffect(UHealthComponent* target, FName effectName, float ratePerSecond, float duration, AController* instigator, AActor* causer);
+
+	void RemoveEffect(uint32 handle);
+
+	void RemoveEffect(UHealthComponent* target, FName effectName, AActor* causer);
+
+	// Removes every effect on the target, e.g. when it dies
+	void RemoveEffects(UHealthComponent* target);
+
+	FORCEINLINE int32 GetNumEffects() const { return handles.Num(); }
+
+	// Steps per second, effects are applied in steps of 1/stepRate seconds
+	UPROPERTY(config)
+	float stepRate;
+
+	// Steps run in a single frame at most, so a hitch does not turn into a burst of work
+	UPROPERTY(config)
+	int32 maxStepsPerTick;
+
+protected:
+	void Step(float stepTime);
+
+	// index of the target in the target table, added on first use
+	int32 GetOrAddTarget(UHealthComponent* target);
+
+	int32 FindEffect(int32 targetIndex, FName effectName, const AActor* causer) const;
+
+	void RemoveEffectAt(int32 index);
+
+protected:
+	// one entry per active effect, removed by swapping with the last one
+	TArray<uint32> handles;
+	TArray<int32> effectTargets;
+	TArray<FName> effectNames;
+	TArray<float> rates;
+	// seconds left, negative for effects that last until removed
+	TArray<float> remainingTimes;
+	TArray<TWeakObjectPtr<AController>> instigators;
+	TArray<TWeakObjectPtr<AActor>> causers;
+
+	// one entry per target, compacted when a target has no effects left
+	TArray<TWeakObjectPtr<UHealthComponent>> targets;
+	TArray<int32> targetEffectCounts;
+
+	// scratch per target sums of a step, and the damage effect that gets the credit
+	TArray<float> targetDeltas;
+	TArray<int32> targetDamageEffects;
+
+	uint32 lastHandle = 0;
+
+	float stepAccumulator = 0.0f;
+
+	bool bInitialized = false;
+};
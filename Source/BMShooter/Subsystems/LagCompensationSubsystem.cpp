@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LagCompensationSubsystem.h"
+#include "Components/HitboxHistoryComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "BMShooterCharacter.h"
+#include "Engine/World.h"
+
+namespace {
+	// Distance along the ray to the capsule surface, or -1 if it is missed. Uses the sphere entry around the closest
+	// approach, exact for the caps and close enough for the cylinder at hit validation scale
+	float IntersectCapsule(const FVector& start, const FVector& direction, float maxDistance, const FHitboxSnapshot& capsule, FVector& outNormal) {
+		const FVector axis = capsule.rotation.GetUpVector() * FMath::Max(capsule.halfHeight - capsule.radius, 0.0f);
+
+		FVector onRay;
+		FVector onAxis;
+		FMath::SegmentDistToSegmentSafe(start, start + direction * maxDistance, capsule.location - axis, capsule.location + axis, onRay, onAxis);
+
+		const float distanceSquared = FVector::DistSquared(onRay, onAxis);
+		const float radiusSquared = FMath::Square(capsule.radius);
+		if (distanceSquared > radiusSquared) {
+			return -1.0f;
+		}
+
+		const float entry = FMath::Max(FVector::DotProduct(onRay - start, direction) - FMath::Sqrt(radiusSquared - distanceSquared), 0.0f);
+		outNormal = (start + direction * entry - onAxis).GetSafeNormal();
+		return entry;
+	}
+}
+
+ULagCompensationSubsystem::ULagCompensationSubsystem() {
+	maxRewindTime = 0.25f;
+	historySampleRate = 60.0f;
+}
+
+void ULagCompensationSubsystem::RegisterHitbox(UHitboxHistoryComponent* hitbox) {
+	hitboxes.AddUnique(hitbox);
+}
+
+void ULagCompensationSubsystem::UnregisterHitbox(UHitboxHistoryComponent* hitbox) {
+	hitboxes.RemoveSwap(hitbox);
+}
+
+bool ULagCompensationSubsystem::RewindLineTrace(const FVector& start, const FVector& end, float fireTime, const AActor* shooter, FHitResult& outHit) const {
+	UWorld* world = GetWorld();
+	const FVector traceDelta = end - start;
+	const float traceLength = traceDelta.Size();
+	if (!world || traceLength <= KINDA_SMALL_NUMBER) {
+		return false;
+	}
+
+	const FVector traceDirection = traceDelta / traceLength;
+	const float now = world->GetTimeSeconds();
+	const float rewindTime = FMath::Clamp(fireTime, now - maxRewindTime, now);
+
+	// find the closest rewound capsule along the ray
+	float hitDistance = traceLength;
+	FVector hitNormal = FVector::ZeroVector;
+	const UHitboxHistoryComponent* hitHitbox = nullptr;
+	FHitboxSnapshot snapshot;
+	for (const UHitboxHistoryComponent* hitbox : hitboxes) {
+		if (!hitbox) {
+			continue;
+		}
+
+		const ABMShooterCharacter* character = Cast<ABMShooterCharacter>(hitbox->GetOwner());
+		if (!character || character == shooter || character->characterDead) {
+			continue;
+		}
+
+		if (!hitbox->GetHitboxAtTime(rewindTime, snapshot)) {
+			continue;
+		}
+
+		FVector normal;
+		const float distance = IntersectCapsule(start, traceDirection, hitDistance, snapshot, normal);
+		if (distance >= 0.0f && distance < hitDistance) {
+			hitDistance = distance;
+			hitNormal = normal;
+			hitHitbox = hitbox;
+		}
+	}
+
+	if (!hitHitbox) {
+		return false;
+	}
+
+	const FVector impactPoint = start + traceDirection * hitDistance;
+
+	// the world is not rewound, only check static and dynamic geometry between the shooter and the hit
+	FCollisionQueryParams queryParams(SCENE_QUERY_STAT(LagCompensatedTrace), true, shooter);
+	FCollisionObjectQueryParams objectParams;
+	objectParams.AddObjectTypesToQuery(ECC_WorldStatic);
+	objectParams.AddObjectTypesToQuery(ECC_WorldDynamic);
+	FHitResult blockingHit;
+	if (world->LineTraceSingleByObjectType(blockingHit, start, impactPoint, objectParams, queryParams)) {
+		return false;
+	}
+
+	ABMShooterCharacter* hitCharacter = Cast<ABMShooterCharacter>(hitHitbox->GetOwner());
+	outHit = FHitResult(hitCharacter, hitCharacter->GetCapsuleComponent(), impactPoint, hitNormal);
+	outHit.TraceStart = start;
+	outHit.TraceEnd = end;
+	outHit.Distance = hitDistance;
+	outHit.Time = hitDistance / traceLength;
+	return true;
+}
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "LagCompensationSubsystem.generated.h"
+
+class UHitboxHistoryComponent;
+
+/**
+ * Rewinds character hitboxes to the time a client fired and traces against them.
+ * Hitboxes are analytic capsules from each character's history, nothing is moved in the physics scene.
+ */
+UCLASS(config=Game)
+class BMSHOOTER_API ULagCompensationSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	ULagCompensationSubsystem();
+
+	void RegisterHitbox(UHitboxHistoryComponent* hitbox);
+
+	void UnregisterHitbox(UHitboxHistoryComponent* hitbox);
+
+	/**
+	 * Traces from start to end against the hitboxes as they were at fireTime, then checks the world is not in the way.
+	 * @param fireTime	Server time the client saw when firing, clamped to the rewind window
+	 * @return true if a character was hit
+	 */
+	bool RewindLineTrace(const FVector& start, const FVector& end, float fireTime, const AActor* shooter, FHitResult& outHit) const;
+
+	// Max seconds a shot can be rewound, higher pings are treated as if they had this one
+	UPROPERTY(config)
+	float maxRewindTime;
+
+	// Hitbox snapshots recorded per second
+	UPROPERTY(config)
+	float historySampleRate;
+
+protected:
+	UPROPERTY()
+	TArray<UHitboxHistoryComponent*> hitboxes;
+};
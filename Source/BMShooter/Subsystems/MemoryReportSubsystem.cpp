@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MemoryReportSubsystem.h"
+#include "BMShooterCharacter.h"
+#include "BMShooterProjectile.h"
+#include "Components/HealthComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectHash.h"
+#include "BMShooterStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Memory Report Sample"), STAT_MemoryReportSample, STATGROUP_BMShooter);
+
+DEFINE_LOG_CATEGORY_STATIC(LogMemReport, Log, All);
+
+UMemoryReportSubsystem::UMemoryReportSubsystem() {
+	sampleInterval = 1.0f;
+}
+
+void UMemoryReportSubsystem::Initialize(FSubsystemCollectionBase& Collection) {
+	Super::Initialize(Collection);
+
+	auto addTag = [this](const TCHAR* name, UClass* objectClass, int32 llmTag) {
+		FBMMemoryTagReport& tag = tags.AddDefaulted_GetRef();
+		tag.name = name;
+		tag.objectClass = objectClass;
+		tag.llmTag = llmTag;
+	};
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+	addTag(TEXT("BMCharacters"), ABMShooterCharacter::StaticClass(), (int32)EBMLLMTag::Characters);
+	addTag(TEXT("BMProjectiles"), ABMShooterProjectile::StaticClass(), (int32)EBMLLMTag::Projectiles);
+	addTag(TEXT("BMHealth"), UHealthComponent::StaticClass(), (int32)EBMLLMTag::Health);
+	addTag(TEXT("BMCosmetics"), USkeletalMeshComponent::StaticClass(), (int32)EBMLLMTag::Cosmetics);
+#else
+	addTag(TEXT("BMCharacters"), ABMShooterCharacter::StaticClass(), 0);
+	addTag(TEXT("BMProjectiles"), ABMShooterProjectile::StaticClass(), 0);
+	addTag(TEXT("BMHealth"), UHealthComponent::StaticClass(), 0);
+	addTag(TEXT("BMCosmetics"), USkeletalMeshComponent::StaticClass(), 0);
+#endif
+
+	bInitialized = true;
+}
+
+void UMemoryReportSubsystem::Deinitialize() {
+	bInitialized = false;
+	tags.Empty();
+	Super::Deinitialize();
+}
+
+bool UMemoryReportSubsystem::IsTickable() const {
+	return bInitialized;
+}
+
+TStatId UMemoryReportSubsystem::GetStatId() const {
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMemoryReportSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UMemoryReportSubsystem::GetTickableGameObjectWorld() const {
+	return GetWorld();
+}
+
+void UMemoryReportSubsystem::Tick(float DeltaTime) {
+	timeUntilSample -= DeltaTime;
+	if (timeUntilSample > 0.0f) {
+		return;
+	}
+	timeUntilSample = sampleInterval;
+
+	Sample();
+}
+
+void UMemoryReportSubsystem::Sample() {
+	BM_SCOPE_CYCLE_COUNTER(STAT_MemoryReportSample);
+
+	UWorld* world = GetWorld();
+	for (FBMMemoryTagReport& tag : tags) {
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+		if (FLowLevelMemTracker::IsEnabled()) {
+			tag.currentBytes = FLowLevelMemTracker::Get().GetTagAmountForTracker(ELLMTracker::Default, (ELLMTag)tag.llmTag);
+			tag.peakBytes = FMath::Max(tag.peakBytes, tag.currentBytes);
+		}
+#endif
+
+		// objects of this world only, through the class hash so no full object array walk
+		const bool bCharacterMeshes = tag.objectClass == USkeletalMeshComponent::StaticClass();
+		int32 liveObjects = 0;
+		ForEachObjectOfClass(tag.objectClass, [world, bCharacterMeshes, &liveObjects](UObject* object) {
+			if (object->IsPendingKill() || object->GetWorld() != world) {
+				return;
+			}
+
+			// only the meshes of our characters count as cosmetics
+			if (bCharacterMeshes && !object->GetOuter()->IsA(ABMShooterCharacter::StaticClass())) {
+				return;
+			}
+			liveObjects++;
+		});
+
+		tag.liveObjects = liveObjects;
+		tag.peakObjects = FMath::Max(tag.peakObjects, liveObjects);
+	}
+}
+
+void UMemoryReportSubsystem::WriteReport(bool bWriteFile) {
+	Sample();
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+	const bool bTrackingMemory = FLowLevelMemTracker::IsEnabled();
+#else
+	const bool bTrackingMemory = false;
+#endif
+	if (!bTrackingMemory) {
+		UE_LOG(LogMemReport, Log, TEXT("LLM is off, run with -llm to track memory. Only object counts are reported"));
+	}
+
+	FString csv = TEXT("tag,current_kb,peak_kb,live_objects,peak_objects,bytes_per_object\n");
+	for (const FBMMemoryTagReport& tag : tags) {
+		const int64 bytesPerObject = tag.liveObjects > 0 ? tag.currentBytes / tag.liveObjects : 0;
+		UE_LOG(LogMemReport, Log, TEXT("%-14s current %8.1f KB  peak %8.1f KB  objects %5d (peak %5d)  %lld bytes per object"),
+			tag.name, tag.currentBytes / 1024.0, tag.peakBytes / 1024.0, tag.liveObjects, tag.peakObjects, bytesPerObject);
+
+		csv += FString::Printf(TEXT("%s,%.1f,%.1f,%d,%d,%lld\n"), tag.name, tag.currentBytes / 1024.0, tag.peakBytes / 1024.0, tag.liveObjects, tag.peakObjects, bytesPerObject);
+	}
+
+	if (bWriteFile) {
+		const FString csvPath = FPaths::ProjectSavedDir() / TEXT("MemReport") / FString::Printf(TEXT("MemReport_%s_%s.csv"), *GetWorld()->GetMapName(), *FDateTime::Now().ToString());
+		if (FFileHelper::SaveStringToFile(csv, *csvPath)) {
+			UE_LOG(LogMemReport, Log, TEXT("Memory report written to %s"), *csvPath);
+		}
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+// Logs the memory and objects of the module's tags, -file also writes the CSV
+static FAutoConsoleCommandWithWorldAndArgs MemReportCommand(
+	TEXT("bm.MemReport"),
+	TEXT("bm.MemReport [-file]: logs current and peak memory and live objects per BMShooter LLM tag"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& args, UWorld* world) {
+		UMemoryReportSubsystem* memoryReport = world ? world->GetSubsystem<UMemoryReportSubsystem>() : nullptr;
+		if (memoryReport) {
+			memoryReport->WriteReport(args.Contains(TEXT("-file")));
+		}
+	})
+);
+#endif
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "MemoryReportSubsystem.generated.h"
+
+// Memory of one of the module's LLM tags and the objects it is spent on
+struct FBMMemoryTagReport
+{
+	const TCHAR* name = nullptr;
+	UClass* objectClass = nullptr;
+	int32 llmTag = 0;
+
+	int64 currentBytes = 0;
+	int64 peakBytes = 0;
+	int32 liveObjects = 0;
+	int32 peakObjects = 0;
+};
+
+/**
+ * Samples the memory of the module's LLM tags and the live objects of each tag once per second, keeping the peaks,
+ * and reports them as bytes per character, per projectile and so on. Written to the log and Saved/MemReport at the
+ * end of the match or with bm.MemReport. Memory is only tracked when the game runs with -llm, the object counts always.
+ */
+UCLASS(config=Game)
+class BMSHOOTER_API UMemoryReportSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UMemoryReportSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+	// Samples once more and writes the report to the log and, if writeFile, to Saved/MemReport
+	void WriteReport(bool bWriteFile);
+
+	// Seconds between two samples
+	UPROPERTY(config)
+	float sampleInterval;
+
+protected:
+	void Sample();
+
+protected:
+	TArray<FBMMemoryTagReport> tags;
+
+	float timeUntilSample = 0.0f;
+
+	bool bInitialized = false;
+};
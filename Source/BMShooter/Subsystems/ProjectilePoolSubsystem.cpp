@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectilePoolSubsystem.h"
+#include "BMShooterProjectile.h"
+#include "Engine/World.h"
+#include "BMShooterStats.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Projectiles"), STAT_PooledProjectiles, STATGROUP_BMShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Projectiles In Use"), STAT_PooledProjectilesInUse, STATGROUP_BMShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Projectiles High Water Mark"), STAT_PooledProjectilesHighWater, STATGROUP_BMShooter);
+
+DEFINE_LOG_CATEGORY_STATIC(LogProjectilePool, Log, All);
+
+UProjectilePoolSubsystem::UProjectilePoolSubsystem() {
+	defaultPrewarmCount = 32;
+}
+
+void UProjectilePoolSubsystem::Deinitialize() {
+	for (const TPair<UClass*, FProjectilePoolBucket>& bucket : buckets) {
+		UE_LOG(LogProjectilePool, Log, TEXT("%s: %d spawned, high water mark %d"), *GetNameSafe(bucket.Key), bucket.Value.numSpawned, bucket.Value.highWaterMark);
+	}
+	buckets.Empty();
+	UpdateStats();
+
+	Super::Deinitialize();
+}
+
+void UProjectilePoolSubsystem::Prewarm(TSubclassOf<ABMShooterProjectile> projectileClass, int32 count) {
+	if (!projectileClass) {
+		return;
+	}
+
+	if (count <= 0) {
+		count = defaultPrewarmCount;
+	}
+
+	FProjectilePoolBucket& bucket = buckets.FindOrAdd(projectileClass);
+	bucket.freeProjectiles.Reserve(count);
+	while (bucket.numSpawned < count) {
+		ABMShooterProjectile* projectile = SpawnPooledProjectile(projectileClass);
+		if (!projectile) {
+			break;
+		}
+		bucket.freeProjectiles.Add(projectile);
+	}
+
+	UpdateStats();
+}
+
+ABMShooterProjectile* UProjectilePoolSubsystem::AcquireProjectile(TSubclassOf<ABMShooterProjectile> projectileClass, const FTransform& spawnTransform, AActor* owner, APawn* instigator) {
+	if (!projectileClass) {
+		return nullptr;
+	}
+
+	FProjectilePoolBucket& bucket = buckets.FindOrAdd(projectileClass);
+
+	ABMShooterProjectile* projectile = nullptr;
+	while (!projectile && bucket.freeProjectiles.Num() > 0) {
+		// entries get nulled if something else destroyed the actor
+		projectile = bucket.freeProjectiles.Pop(false);
+		if (projectile == nullptr) {
+			bucket.numSpawned--;
+		}
+	}
+
+	if (!projectile) {
+		// grow on demand
+		projectile = SpawnPooledProjectile(projectileClass);
+		if (!projectile) {
+			return nullptr;
+		}
+	}
+
+	bucket.numInUse++;
+	bucket.highWaterMark = FMath::Max(bucket.highWaterMark, bucket.numInUse);
+
+	projectile->ActivateFromPool(spawnTransform, owner, instigator);
+
+	UpdateStats();
+	return projectile;
+}
+
+void UProjectilePoolSubsystem::ReleaseProjectile(ABMShooterProjectile* projectile) {
+	// a projectile can hit several things in the same frame, only park it once
+	if (!projectile || !projectile->poolLaunch.active) {
+		return;
+	}
+
+	projectile->DeactivateToPool();
+
+	FProjectilePoolBucket& bucket = buckets.FindOrAdd(projectile->GetClass());
+	bucket.numInUse = FMath::Max(bucket.numInUse - 1, 0);
+	bucket.freeProjectiles.Add(projectile);
+
+	UpdateStats();
+}
+
+int32 UProjectilePoolSubsystem::GetPoolSize(TSubclassOf<ABMShooterProjectile> projectileClass) const {
+	const FProjectilePoolBucket* bucket = buckets.Find(projectileClass);
+	return bucket ? bucket->numSpawned : 0;
+}
+
+int32 UProjectilePoolSubsystem::GetHighWaterMark(TSubclassOf<ABMShooterProjectile> projectileClass) const {
+	const FProjectilePoolBucket* bucket = buckets.Find(projectileClass);
+	return bucket ? bucket->highWaterMark : 0;
+}
+
+ABMShooterProjectile* UProjectilePoolSubsystem::SpawnPooledProjectile(UClass* projectileClass) {
+	UWorld* world = GetWorld();
+	if (!world) {
+		return nullptr;
+	}
+
+	BM_LLM_SCOPE(Projectiles);
+
+	FActorSpawnParameters spawnParams;
+	spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	ABMShooterProjectile* projectile = world->SpawnActor<ABMShooterProjectile>(projectileClass, FTransform::Identity, spawnParams);
+	if (!projectile) {
+		return nullptr;
+	}
+
+	projectile->bPooled = true;
+	projectile->DeactivateToPool();
+
+	buckets.FindOrAdd(projectileClass).numSpawned++;
+	return projectile;
+}
+
+void UProjectilePoolSubsystem::UpdateStats() const {
+	int32 numSpawned = 0;
+	int32 numInUse = 0;
+	int32 highWaterMark = 0;
+	for (const TPair<UClass*, FProjectilePoolBucket>& bucket : buckets) {
+		numSpawned += bucket.Value.numSpawned;
+		numInUse += bucket.Value.numInUse;
+		highWaterMark += bucket.Value.highWaterMark;
+	}
+
+	SET_DWORD_STAT(STAT_PooledProjectiles, numSpawned);
+	SET_DWORD_STAT(STAT_PooledProjectilesInUse, numInUse);
+	SET_DWORD_STAT(STAT_PooledProjectilesHighWater, highWaterMark);
+}
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectilePoolSubsystem.generated.h"
+
+class ABMShooterProjectile;
+
+// Projectiles of one class owned by the pool
+USTRUCT()
+struct FProjectilePoolBucket
+{
+	GENERATED_BODY()
+
+	// parked projectiles ready to be handed out
+	UPROPERTY()
+	TArray<ABMShooterProjectile*> freeProjectiles;
+
+	int32 numSpawned = 0;
+
+	int32 numInUse = 0;
+
+	// max projectiles of this class in use at the same time
+	int32 highWaterMark = 0;
+};
+
+/**
+ * Keeps spawned projectiles alive and recycles them, so firing does not go through SpawnActor/Destroy and the GC.
+ * Only the server (or a standalone game) pools, replicated projectiles are relaunched on clients through their launch state.
+ */
+UCLASS(config=Game)
+class BMSHOOTER_API UProjectilePoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UProjectilePoolSubsystem();
+
+	virtual void Deinitialize() override;
+
+	// Spawns projectiles of the given class until the pool holds at least count of them
+	UFUNCTION(BlueprintCallable, Category = Projectile)
+	void Prewarm(TSubclassOf<ABMShooterProjectile> projectileClass, int32 count);
+
+	// Hands out a projectile launched from spawnTransform, growing the pool if there is no free one
+	UFUNCTION(BlueprintCallable, Category = Projectile)
+	ABMShooterProjectile* AcquireProjectile(TSubclassOf<ABMShooterProjectile> projectileClass, const FTransform& spawnTransform, AActor* owner, APawn* instigator);
+
+	// Parks the projectile until it is acquired again
+	void ReleaseProjectile(ABMShooterProjectile* projectile);
+
+	// Number of projectiles of the given class owned by the pool, in use or not
+	UFUNCTION(BlueprintPure, Category = Projectile)
+	int32 GetPoolSize(TSubclassOf<ABMShooterProjectile> projectileClass) const;
+
+	UFUNCTION(BlueprintPure, Category = Projectile)
+	int32 GetHighWaterMark(TSubclassOf<ABMShooterProjectile> projectileClass) const;
+
+	// Number of projectiles to prewarm per class when no explicit count is given
+	UPROPERTY(config)
+	int32 defaultPrewarmCount;
+
+protected:
+	ABMShooterProjectile* SpawnPooledProjectile(UClass* projectileClass);
+
+	void UpdateStats() const;
+
+	UPROPERTY()
+	TMap<UClass*, FProjectilePoolBucket> buckets;
+};
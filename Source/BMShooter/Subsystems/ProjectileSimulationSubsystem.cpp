@@ -0,0 +1,387 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectileSimulationSubsystem.h"
+#include "BMShooterProjectile.h"
+#include "BMShooterCharacter.h"
+#include "CombatEventSubsystem.h"
+#include "CosmeticEventSubsystem.h"
+#include "BMShooterShotStream.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Components/SphereComponent.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "BMShooterStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Simulation Tick"), STAT_ProjectileSimTick, STATGROUP_BMShooter);
+DECLARE_CYCLE_STAT(TEXT("Projectile Simulation Resolve Sweeps"), STAT_ProjectileSimResolve, STATGROUP_BMShooter);
+DECLARE_CYCLE_STAT(TEXT("Projectile Simulation Integrate"), STAT_ProjectileSimIntegrate, STATGROUP_BMShooter);
+DECLARE_CYCLE_STAT(TEXT("Projectile Simulation Issue Sweeps"), STAT_ProjectileSimSweeps, STATGROUP_BMShooter);
+DECLARE_CYCLE_STAT(TEXT("Projectile Simulation Update Visuals"), STAT_ProjectileSimVisuals, STATGROUP_BMShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectiles In Flight"), STAT_ProjectileSimNum, STATGROUP_BMShooter);
+
+namespace {
+	// projectiles integrated by each ParallelFor task
+	const int32 IntegrationBatchSize = 256;
+
+	// collision channel of the Projectile object type, see DefaultEngine.ini
+	const ECollisionChannel ProjectileChannel = ECC_GameTraceChannel1;
+}
+
+void UProjectileSimulationSubsystem::Initialize(FSubsystemCollectionBase& Collection) {
+	Super::Initialize(Collection);
+	bInitialized = true;
+}
+
+void UProjectileSimulationSubsystem::Deinitialize() {
+	bInitialized = false;
+	OnShotEnded.Clear();
+	shotIndices.Empty();
+	visuals.Empty();
+	freeVisuals.Empty();
+	Super::Deinitialize();
+}
+
+bool UProjectileSimulationSubsystem::IsTickable() const {
+	return bInitialized && positions.Num() > 0;
+}
+
+TStatId UProjectileSimulationSubsystem::GetStatId() const {
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileSimulationSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UProjectileSimulationSubsystem::GetTickableGameObjectWorld() const {
+	return GetWorld();
+}
+
+int32 UProjectileSimulationSubsystem::SpawnProjectile(TSubclassOf<ABMShooterProjectile> projectileClass, FVector origin, FVector direction, APawn* instigator) {
+	return SpawnShot(projectileClass, origin, direction, instigator, 0, 0.0f);
+}
+
+int32 UProjectileSimulationSubsystem::SpawnShot(TSubclassOf<ABMShooterProjectile> projectileClass, const FVector& origin, const FVector& direction, APawn* instigator, uint32 shotId, float catchUpTime) {
+	if (!projectileClass) {
+		return INDEX_NONE;
+	}
+
+	BM_LLM_SCOPE(Projectiles);
+
+	const int32 paramsIndex = FindOrAddParams(projectileClass);
+	const FProjectileSimParams& params = simParams[paramsIndex];
+
+	positions.Add(origin);
+	velocities.Add(direction.GetSafeNormal() * params.ballistics.initialSpeed);
+	sweepEnds.Add(origin);
+	remainingLife.Add(params.lifeSpan > 0.0f ? params.lifeSpan : MAX_flt);
+	bounceCounts.Add(0);
+	paramsIndices.Add(paramsIndex);
+	instigators.Add(instigator);
+	sweepHandles.AddDefaulted();
+	shotIds.Add(shotId);
+	catchUpTimes.Add(catchUpTime);
+
+	// benchmark shots have no id and stay invisible, there can be thousands of them
+	const bool bVisible = shotId != 0 && !GetWorld()->IsNetMode(NM_DedicatedServer);
+	visuals.Add(bVisible ? AcquireVisual(projectileClass, FTransform(direction.Rotation(), origin)) : nullptr);
+
+	const int32 index = positions.Num() - 1;
+	if (shotId != 0) {
+		shotIndices.Add(shotId, index);
+	}
+
+	SET_DWORD_STAT(STAT_ProjectileSimNum, positions.Num());
+	return index;
+}
+
+void UProjectileSimulationSubsystem::RemoveShot(uint32 shotId) {
+	const int32* index = shotIndices.Find(shotId);
+	if (index) {
+		RemoveProjectile(*index, false);
+	}
+}
+
+ABMShooterShotStream* UProjectileSimulationSubsystem::GetShotStream() {
+	UWorld* world = GetWorld();
+	if (!shotStream.IsValid() && world->GetNetMode() != NM_Client) {
+		FActorSpawnParameters spawnParams;
+		spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		shotStream = world->SpawnActor<ABMShooterShotStream>(spawnParams);
+	}
+	return shotStream.Get();
+}
+
+int32 UProjectileSimulationSubsystem::FindOrAddParams(UClass* projectileClass) {
+	for (int32 i = 0; i < simParams.Num(); i++) {
+		if (simParams[i].projectileClass == projectileClass) {
+			return i;
+		}
+	}
+
+	// same values the actor would use, Blueprint overrides included
+	const ABMShooterProjectile* projectile = projectileClass->GetDefaultObject<ABMShooterProjectile>();
+	const UProjectileMovementComponent* movement = projectile->GetProjectileMovement();
+
+	FProjectileSimParams& params = simParams.AddDefaulted_GetRef();
+	params.projectileClass = projectileClass;
+	params.ballistics.initialSpeed = movement->InitialSpeed;
+	params.ballistics.maxSpeed = movement->MaxSpeed;
+	params.ballistics.gravityZ = GetWorld()->GetGravityZ() * movement->ProjectileGravityScale;
+	params.ballistics.bShouldBounce = movement->bShouldBounce;
+	params.ballistics.bounciness = movement->Bounciness;
+	params.ballistics.friction = movement->Friction;
+	params.ballistics.bounceStopSpeed = movement->BounceVelocityStopSimulatingThreshold;
+	params.radius = projectile->GetCollisionComp()->GetScaledSphereRadius();
+	params.lifeSpan = projectile->InitialLifeSpan;
+	params.damage = projectile->GetDamage();
+	params.radialDamage = projectile->GetRadialDamage();
+
+	return simParams.Num() - 1;
+}
+
+void UProjectileSimulationSubsystem::Tick(float DeltaTime) {
+	BM_SCOPE_CYCLE_COUNTER(STAT_ProjectileSimTick);
+
+	ResolveSweeps();
+	Integrate(DeltaTime);
+	IssueSweeps();
+	UpdateVisuals();
+
+	SET_DWORD_STAT(STAT_ProjectileSimNum, positions.Num());
+}
+
+void UProjectileSimulationSubsystem::ResolveSweeps() {
+	BM_SCOPE_CYCLE_COUNTER(STAT_ProjectileSimResolve);
+
+	UWorld* world = GetWorld();
+	FTraceDatum traceData;
+
+	// backwards so removing with a swap only moves already resolved projectiles
+	for (int32 i = positions.Num() - 1; i >= 0; i--) {
+		const FHitResult* blockingHit = nullptr;
+		if (sweepHandles[i].IsValid() && world->QueryTraceData(sweepHandles[i], traceData)) {
+			for (const FHitResult& hit : traceData.OutHits) {
+				if (hit.bBlockingHit) {
+					blockingHit = &hit;
+					break;
+				}
+			}
+		}
+		sweepHandles[i] = FTraceHandle();
+
+		if (blockingHit) {
+			if (HandleImpact(i, *blockingHit)) {
+				continue;
+			}
+		}
+		else {
+			positions[i] = sweepEnds[i];
+		}
+
+		if (remainingLife[i] <= 0.0f) {
+			RemoveProjectile(i);
+		}
+	}
+}
+
+void UProjectileSimulationSubsystem::Integrate(float DeltaTime) {
+	BM_SCOPE_CYCLE_COUNTER(STAT_ProjectileSimIntegrate);
+
+	const int32 numProjectiles = positions.Num();
+	const int32 numBatches = FMath::DivideAndRoundUp(numProjectiles, IntegrationBatchSize);
+
+	// every projectile only touches its own entries, so batches don't need any locking
+	ParallelFor(numBatches, [this, DeltaTime, numProjectiles](int32 batch) {
+		const int32 last = FMath::Min((batch + 1) * IntegrationBatchSize, numProjectiles);
+		for (int32 i = batch * IntegrationBatchSize; i < last; i++) {
+			const FProjectileSimParams& params = simParams[paramsIndices[i]];
+
+			// streamed shots make up for the time their record took to arrive in their first step
+			const float stepTime = DeltaTime + catchUpTimes[i];
+			catchUpTimes[i] = 0.0f;
+
+			const FVector velocity = BMCombat::IntegrateVelocity(velocities[i], params.ballistics, stepTime);
+			velocities[i] = velocity;
+			sweepEnds[i] = positions[i] + velocity * stepTime;
+			remainingLife[i] -= stepTime;
+		}
+	}, numBatches == 1);
+}
+
+void UProjectileSimulationSubsystem::IssueSweeps() {
+	BM_SCOPE_CYCLE_COUNTER(STAT_ProjectileSimSweeps);
+
+	UWorld* world = GetWorld();
+	FCollisionQueryParams queryParams(SCENE_QUERY_STAT(ProjectileSimSweep), false);
+
+	for (int32 i = 0; i < positions.Num(); i++) {
+		queryParams.ClearIgnoredActors();
+		if (APawn* instigator = instigators[i].Get()) {
+			queryParams.AddIgnoredActor(instigator);
+		}
+
+		// results are read back on the next tick
+		const FProjectileSimParams& params = simParams[paramsIndices[i]];
+		sweepHandles[i] = world->AsyncSweepByChannel(EAsyncTraceType::Single, positions[i], sweepEnds[i], FQuat::Identity,
+			ProjectileChannel, FCollisionShape::MakeSphere(params.radius), queryParams);
+	}
+}
+
+bool UProjectileSimulationSubsystem::HandleImpact(int32 index, const FHitResult& hit) {
+	const FProjectileSimParams& params = simParams[paramsIndices[index]];
+	AActor* otherActor = hit.GetActor();
+	UPrimitiveComponent* otherComp = hit.GetComponent();
+	APawn* instigator = instigators[index].Get();
+
+	// explosive shots stop at anything but their instigator
+	if (params.radialDamage.outerRadius > 0.0f && (!otherActor || otherActor != instigator)) {
+		positions[index] = hit.Location;
+		if (GetWorld()->GetNetMode() != NM_Client) {
+			UCombatEventSubsystem::ApplyRadialHit(GetWorld(), hit.Location, params.radialDamage, instigator ? instigator->GetController() : nullptr, instigator);
+		}
+		RemoveProjectile(index);
+		return true;
+	}
+
+	// same rules as ABMShooterProjectile::OnHit, clients stop at characters too so streamed shots don't bounce off them
+	if (otherActor && otherActor != instigator && otherActor->IsA(ABMShooterCharacter::StaticClass())) {
+		if (GetWorld()->GetNetMode() != NM_Client) {
+			UCombatEventSubsystem::ApplyHit(GetWorld(), otherActor, params.damage, instigator ? instigator->GetController() : nullptr, instigator);
+			UCosmeticEventSubsystem::QueueEvent(GetWorld(), EBMCosmeticType::Impact, hit.ImpactPoint, hit.ImpactNormal, Cast<ABMShooterCharacter>(instigator));
+		}
+		positions[index] = hit.Location;
+		RemoveProjectile(index);
+		return true;
+	}
+
+	if (otherActor && otherComp && otherComp->IsSimulatingPhysics()) {
+		otherComp->AddImpulseAtLocation(velocities[index] * 100.0f, hit.Location);
+		RemoveProjectile(index);
+		return true;
+	}
+
+	// bounce like UProjectileMovementComponent::ComputeBounceDelta
+	FVector velocity;
+	if (!BMCombat::ComputeBounce(velocities[index], FVector(hit.Normal), params.ballistics, velocity)) {
+		RemoveProjectile(index);
+		return true;
+	}
+
+	// pull back a bit so the next sweep does not start penetrating
+	positions[index] = hit.Location + hit.Normal * 0.1f;
+	velocities[index] = velocity;
+	bounceCounts[index] = (uint8)FMath::Min<int32>(bounceCounts[index] + 1, MAX_uint8);
+	return false;
+}
+
+void UProjectileSimulationSubsystem::RemoveProjectile(int32 index, bool bNotify) {
+	const uint32 shotId = shotIds[index];
+	if (shotId != 0) {
+		shotIndices.Remove(shotId);
+		if (bNotify) {
+			OnShotEnded.Broadcast(shotId, positions[index]);
+		}
+	}
+	ReleaseVisual(visuals[index].Get());
+
+	positions.RemoveAtSwap(index, 1, false);
+	velocities.RemoveAtSwap(index, 1, false);
+	sweepEnds.RemoveAtSwap(index, 1, false);
+	remainingLife.RemoveAtSwap(index, 1, false);
+	bounceCounts.RemoveAtSwap(index, 1, false);
+	paramsIndices.RemoveAtSwap(index, 1, false);
+	instigators.RemoveAtSwap(index, 1, false);
+	sweepHandles.RemoveAtSwap(index, 1, false);
+	shotIds.RemoveAtSwap(index, 1, false);
+	catchUpTimes.RemoveAtSwap(index, 1, false);
+	visuals.RemoveAtSwap(index, 1, false);
+
+	// the last shot took the removed one's place
+	if (index < shotIds.Num() && shotIds[index] != 0) {
+		shotIndices.Add(shotIds[index], index);
+	}
+}
+
+void UProjectileSimulationSubsystem::UpdateVisuals() {
+	BM_SCOPE_CYCLE_COUNTER(STAT_ProjectileSimVisuals);
+
+	for (int32 i = 0; i < visuals.Num(); i++) {
+		ABMShooterProjectile* visual = visuals[i].Get();
+		if (visual) {
+			const FVector& velocity = velocities[i];
+			visual->SetActorLocationAndRotation(positions[i], velocity.IsNearlyZero() ? visual->GetActorRotation() : velocity.Rotation());
+		}
+	}
+}
+
+ABMShooterProjectile* UProjectileSimulationSubsystem::AcquireVisual(UClass* projectileClass, const FTransform& spawnTransform) {
+	for (int32 i = freeVisuals.Num() - 1; i >= 0; i--) {
+		ABMShooterProjectile* visual = freeVisuals[i];
+		if (!visual || visual->IsPendingKill()) {
+			freeVisuals.RemoveAtSwap(i, 1, false);
+		}
+		else if (visual->GetClass() == projectileClass) {
+			freeVisuals.RemoveAtSwap(i, 1, false);
+			visual->SetActorTransform(spawnTransform);
+			visual->SetActorHiddenInGame(false);
+			return visual;
+		}
+	}
+
+	FActorSpawnParameters spawnParams;
+	spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	spawnParams.ObjectFlags |= RF_Transient;
+	ABMShooterProjectile* visual = GetWorld()->SpawnActor<ABMShooterProjectile>(projectileClass, spawnTransform, spawnParams);
+	if (visual) {
+		visual->InitSimulatedVisual();
+	}
+	return visual;
+}
+
+void UProjectileSimulationSubsystem::ReleaseVisual(ABMShooterProjectile* visual) {
+	if (visual) {
+		visual->SetActorHiddenInGame(true);
+		freeVisuals.Add(visual);
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+// Launches count projectiles in a fan from the first player, either batched or as actors, to compare both paths with stat unit / stat game
+static FAutoConsoleCommandWithWorldAndArgs ProjectileBenchmarkCommand(
+	TEXT("bm.ProjectileBenchmark"),
+	TEXT("bm.ProjectileBenchmark <count> [actors]: launches count projectiles from the first player, batched unless actors is given"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& args, UWorld* world) {
+		if (!world || args.Num() < 1) {
+			return;
+		}
+
+		const int32 count = FCString::Atoi(*args[0]);
+		const bool bUseActors = args.Num() > 1 && args[1] == TEXT("actors");
+
+		APlayerController* playerController = world->GetFirstPlayerController();
+		ABMShooterCharacter* character = playerController ? Cast<ABMShooterCharacter>(playerController->GetPawn()) : nullptr;
+		if (!character || !character->ProjectileClass) {
+			return;
+		}
+
+		UProjectileSimulationSubsystem* simulation = world->GetSubsystem<UProjectileSimulationSubsystem>();
+		const FVector origin = character->GetActorLocation() + FVector(0.0f, 0.0f, 100.0f);
+		for (int32 i = 0; i < count; i++) {
+			// spread over a hemisphere so the shots don't all hit the same spot
+			const float yaw = 360.0f * i / FMath::Max(count, 1);
+			const float pitch = 10.0f + 60.0f * FMath::Frac(i * 0.618034f);
+			const FVector direction = FRotator(pitch, yaw, 0.0f).Vector();
+
+			if (bUseActors) {
+				FActorSpawnParameters spawnParams;
+				spawnParams.Instigator = character;
+				spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+				world->SpawnActor<ABMShooterProjectile>(character->ProjectileClass, origin + direction * 50.0f, direction.Rotation(), spawnParams);
+			}
+			else if (simulation) {
+				simulation->SpawnProjectile(character->ProjectileClass, origin + direction * 50.0f, direction, character);
+			}
+		}
+	})
+);
+#endif
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "WorldCollision.h"
+#include "CombatCore/Ballistics.h"
+#include "ProjectileSimulationSubsystem.generated.h"
+
+class ABMShooterProjectile;
+class ABMShooterShotStream;
+
+// Flight settings shared by every shot of a projectile class, read from its class defaults
+struct FProjectileSimParams
+{
+	TSubclassOf<ABMShooterProjectile> projectileClass;
+	BMCombat::FBallisticParams ballistics;
+	float radius = 0.0f;
+	float lifeSpan = 0.0f;
+	float damage = 0.0f;
+	// outerRadius is 0 for projectiles that don't explode
+	BMCombat::FRadialDamage radialDamage;
+};
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnSimulatedShotEnded, uint32 /*shotId*/, const FVector& /*location*/);
+
+/**
+ * Simulates projectiles without actors. Shots in flight are kept as arrays of plain data, integrated together
+ * in one tick and swept with async traces whose results are resolved on the next tick.
+ * Impacts do what ABMShooterProjectile::OnHit does: damage characters on the server and push simulating bodies.
+ * Where someone sees them, shots launched with an id are shown by local projectile actors that only follow the
+ * simulation, recycled between shots.
+ */
+UCLASS()
+class BMSHOOTER_API UProjectileSimulationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+	// Launches a shot with the flight settings of projectileClass, not shown. Returns its index in the simulation
+	UFUNCTION(BlueprintCallable, Category = Projectile)
+	int32 SpawnProjectile(TSubclassOf<ABMShooterProjectile> projectileClass, FVector origin, FVector direction, APawn* instigator);
+
+	/**
+	 * Launches a shot that can be found again by its id, 0 for none. Shots with an id are shown on non dedicated machines.
+	 * @param catchUpTime	Seconds of flight added to the first step, swept like the rest of it
+	 */
+	int32 SpawnShot(TSubclassOf<ABMShooterProjectile> projectileClass, const FVector& origin, const FVector& direction, APawn* instigator, uint32 shotId, float catchUpTime);
+
+	// Removes a shot launched with an id, without broadcasting OnShotEnded
+	void RemoveShot(uint32 shotId);
+
+	// Server: the shot stream of this world, spawned on first use
+	ABMShooterShotStream* GetShotStream();
+
+	// A shot launched with an id hit something or expired
+	FOnSimulatedShotEnded OnShotEnded;
+
+	FORCEINLINE int32 GetNumProjectiles() const { return positions.Num(); }
+
+	FORCEINLINE const TArray<FVector>& GetPositions() const { return positions; }
+
+	FORCEINLINE const TArray<uint32>& GetShotIds() const { return shotIds; }
+
+protected:
+	int32 FindOrAddParams(UClass* projectileClass);
+
+	// Moves every projectile to the end of its last sweep, or to the impact point
+	void ResolveSweeps();
+
+	// Advances velocities and computes the end point of this tick's sweeps
+	void Integrate(float DeltaTime);
+
+	void IssueSweeps();
+
+	// Returns true if the projectile was removed
+	bool HandleImpact(int32 index, const FHitResult& hit);
+
+	void RemoveProjectile(int32 index, bool bNotify = true);
+
+	// Moves the actors showing the shots to where the shots are
+	void UpdateVisuals();
+
+	// Local projectile showing a shot of the given class, a free one if there is one
+	ABMShooterProjectile* AcquireVisual(UClass* projectileClass, const FTransform& spawnTransform);
+
+	void ReleaseVisual(ABMShooterProjectile* visual);
+
+protected:
+	TArray<FProjectileSimParams> simParams;
+
+	// one entry per projectile in flight in each array
+	TArray<FVector> positions;
+	TArray<FVector> velocities;
+	TArray<FVector> sweepEnds;
+	TArray<float> remainingLife;
+	TArray<uint8> bounceCounts;
+	TArray<uint16> paramsIndices;
+	TArray<TWeakObjectPtr<APawn>> instigators;
+	TArray<FTraceHandle> sweepHandles;
+	TArray<uint32> shotIds;
+	TArray<float> catchUpTimes;
+	// actor showing each shot, null for the ones nobody sees
+	TArray<TWeakObjectPtr<ABMShooterProjectile>> visuals;
+
+	// hidden visuals waiting for their next shot
+	UPROPERTY()
+	TArray<ABMShooterProjectile*> freeVisuals;
+
+	// index of each shot launched with an id
+	TMap<uint32, int32> shotIndices;
+
+	TWeakObjectPtr<ABMShooterShotStream> shotStream;
+
+	bool bInitialized = false;
+};
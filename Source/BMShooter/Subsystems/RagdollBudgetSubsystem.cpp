@@ -0,0 +1,170 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RagdollBudgetSubsystem.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+#include "BMShooterStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ragdoll Budget Tick"), STAT_RagdollBudgetTick, STATGROUP_BMShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Simulated Ragdolls"), STAT_SimulatedRagdolls, STATGROUP_BMShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ragdolls Frozen"), STAT_RagdollsFrozen, STATGROUP_BMShooter);
+
+URagdollBudgetSubsystem::URagdollBudgetSubsystem() {
+	maxSimulatedRagdolls = 4;
+	maxRagdollDistance = 5000.0f;
+	maxSimulateTime = 4.0f;
+	minSimulateTime = 0.5f;
+	settleSpeed = 20.0f;
+}
+
+void URagdollBudgetSubsystem::Initialize(FSubsystemCollectionBase& Collection) {
+	Super::Initialize(Collection);
+	bInitialized = true;
+}
+
+void URagdollBudgetSubsystem::Deinitialize() {
+	bInitialized = false;
+	ragdolls.Empty();
+	SET_DWORD_STAT(STAT_SimulatedRagdolls, 0);
+	Super::Deinitialize();
+}
+
+bool URagdollBudgetSubsystem::IsTickable() const {
+	return bInitialized && ragdolls.Num() > 0;
+}
+
+TStatId URagdollBudgetSubsystem::GetStatId() const {
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URagdollBudgetSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* URagdollBudgetSubsystem::GetTickableGameObjectWorld() const {
+	return GetWorld();
+}
+
+bool URagdollBudgetSubsystem::GetViewLocation(FVector& outLocation) const {
+	APlayerController* playerController = GetWorld()->GetFirstPlayerController();
+	if (!playerController) {
+		return false;
+	}
+
+	FRotator viewRotation;
+	playerController->GetPlayerViewPoint(outLocation, viewRotation);
+	return true;
+}
+
+bool URagdollBudgetSubsystem::RequestRagdoll(USkeletalMeshComponent* mesh) {
+	if (!mesh) {
+		return false;
+	}
+
+	// a refused body stays in the pose it died in, it doesn't keep animating either
+	UWorld* world = GetWorld();
+	if (world->IsNetMode(NM_DedicatedServer)) {
+		FreezeRagdoll(mesh);
+		return false;
+	}
+
+	FVector viewLocation;
+	const bool bHasView = GetViewLocation(viewLocation);
+	const float distanceSquared = bHasView ? FVector::DistSquared(viewLocation, mesh->GetComponentLocation()) : 0.0f;
+	if (distanceSquared > FMath::Square(maxRagdollDistance)) {
+		FreezeRagdoll(mesh);
+		return false;
+	}
+
+	if (ragdolls.Num() >= maxSimulatedRagdolls) {
+		// make room by freezing the farthest ragdoll, the oldest one if there is no view to measure from or on a tie.
+		// Tick removes with swaps so the array isn't in start order
+		int32 evicted = INDEX_NONE;
+		float evictedDistanceSquared = -1.0f;
+		float evictedStartTime = 0.0f;
+		for (int32 i = 0; i < ragdolls.Num(); i++) {
+			const USkeletalMeshComponent* other = ragdolls[i].mesh.Get();
+			const float otherDistanceSquared = (other && bHasView) ? FVector::DistSquared(viewLocation, other->GetComponentLocation()) : 0.0f;
+			const float otherStartTime = ragdolls[i].startTime;
+			if (otherDistanceSquared > evictedDistanceSquared || (otherDistanceSquared == evictedDistanceSquared && otherStartTime < evictedStartTime)) {
+				evicted = i;
+				evictedDistanceSquared = otherDistanceSquared;
+				evictedStartTime = otherStartTime;
+			}
+		}
+
+		if (evicted == INDEX_NONE || (bHasView && evictedDistanceSquared < distanceSquared)) {
+			// the new body is the farthest one
+			FreezeRagdoll(mesh);
+			return false;
+		}
+
+		FreezeRagdoll(ragdolls[evicted].mesh.Get());
+		ragdolls.RemoveAtSwap(evicted);
+	}
+
+	mesh->bNoSkeletonUpdate = false;
+	mesh->SetComponentTickEnabled(true);
+	mesh->SetCollisionProfileName("Ragdoll");
+	mesh->SetSimulatePhysics(true);
+
+	FRagdollEntry& entry = ragdolls.AddDefaulted_GetRef();
+	entry.mesh = mesh;
+	entry.startTime = world->GetTimeSeconds();
+	SET_DWORD_STAT(STAT_SimulatedRagdolls, ragdolls.Num());
+	return true;
+}
+
+void URagdollBudgetSubsystem::ReleaseRagdoll(USkeletalMeshComponent* mesh) {
+	if (!mesh) {
+		return;
+	}
+
+	ragdolls.RemoveAll([mesh](const FRagdollEntry& entry) { return entry.mesh == mesh; });
+	SET_DWORD_STAT(STAT_SimulatedRagdolls, ragdolls.Num());
+
+	mesh->bNoSkeletonUpdate = false;
+	mesh->SetComponentTickEnabled(true);
+	mesh->SetSimulatePhysics(false);
+}
+
+void URagdollBudgetSubsystem::FreezeRagdoll(USkeletalMeshComponent* mesh) {
+	if (!mesh) {
+		return;
+	}
+
+	BM_COUNT_CALL(STAT_RagdollsFrozen);
+
+	// bones keep the last simulated or animated pose once the skeleton stops updating, nothing left to tick
+	mesh->PutAllRigidBodiesToSleep();
+	mesh->bNoSkeletonUpdate = true;
+	mesh->SetSimulatePhysics(false);
+	mesh->SetComponentTickEnabled(false);
+}
+
+void URagdollBudgetSubsystem::Tick(float DeltaTime) {
+	BM_SCOPE_CYCLE_COUNTER(STAT_RagdollBudgetTick);
+
+	const float now = GetWorld()->GetTimeSeconds();
+	FVector viewLocation;
+	const bool bHasView = GetViewLocation(viewLocation);
+	const float maxDistanceSquared = FMath::Square(maxRagdollDistance);
+	const float settleSpeedSquared = FMath::Square(settleSpeed);
+
+	for (int32 i = ragdolls.Num() - 1; i >= 0; i--) {
+		USkeletalMeshComponent* mesh = ragdolls[i].mesh.Get();
+		if (!mesh) {
+			ragdolls.RemoveAtSwap(i);
+			continue;
+		}
+
+		const float age = now - ragdolls[i].startTime;
+		const bool bTooOld = age > maxSimulateTime;
+		const bool bSettled = age > minSimulateTime && mesh->GetPhysicsLinearVelocity().SizeSquared() < settleSpeedSquared;
+		const bool bTooFar = bHasView && FVector::DistSquared(viewLocation, mesh->GetComponentLocation()) > maxDistanceSquared;
+		if (bTooOld || bSettled || bTooFar) {
+			FreezeRagdoll(mesh);
+			ragdolls.RemoveAtSwap(i);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_SimulatedRagdolls, ragdolls.Num());
+}
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "RagdollBudgetSubsystem.generated.h"
+
+class USkeletalMeshComponent;
+
+struct FRagdollEntry
+{
+	TWeakObjectPtr<USkeletalMeshComponent> mesh;
+	float startTime = 0.0f;
+};
+
+/**
+ * Caps how many ragdolls simulate at once on this machine. Bodies that settle, get too old or are too far from the
+ * local view are frozen in their current pose and taken out of the simulation, and so are the ones the budget refuses
+ * or evicts. Nothing simulates on a dedicated server, where nobody sees the bodies.
+ */
+UCLASS(config=Game)
+class BMSHOOTER_API URagdollBudgetSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	URagdollBudgetSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+	/**
+	 * Starts simulating the mesh as a ragdoll if the budget allows it, freezing the farthest ragdoll if the cap is reached.
+	 * @return true if the mesh is simulating, false if it was frozen instead
+	 */
+	bool RequestRagdoll(USkeletalMeshComponent* mesh);
+
+	// Stops or unfreezes the ragdoll and gives the mesh back to its animation
+	void ReleaseRagdoll(USkeletalMeshComponent* mesh);
+
+	FORCEINLINE int32 GetNumSimulated() const { return ragdolls.Num(); }
+
+	// Ragdolls simulated at the same time
+	UPROPERTY(config)
+	int32 maxSimulatedRagdolls;
+
+	// Ragdolls farther than this from the local view are frozen
+	UPROPERTY(config)
+	float maxRagdollDistance;
+
+	// Seconds a ragdoll simulates before it is frozen wherever it is
+	UPROPERTY(config)
+	float maxSimulateTime;
+
+	// Seconds before a ragdoll can be considered settled
+	UPROPERTY(config)
+	float minSimulateTime;
+
+	// Root body speed below which a ragdoll is settled
+	UPROPERTY(config)
+	float settleSpeed;
+
+protected:
+	// Keeps the mesh in its current pose without simulating, animating or ticking it
+	void FreezeRagdoll(USkeletalMeshComponent* mesh);
+
+	bool GetViewLocation(FVector& outLocation) const;
+
+protected:
+	TArray<FRagdollEntry> ragdolls;
+
+	bool bInitialized = false;
+};
@@ -0,0 +1,416 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ReplayBufferSubsystem.h"
+#include "BMShooterCharacter.h"
+#include "BMShooterProjectile.h"
+#include "Components/HealthComponent.h"
+#include "Subsystems/ProjectileSimulationSubsystem.h"
+#include "Async/Async.h"
+#include "Camera/CameraActor.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+#include "BMShooterStats.h"
+#include <algorithm>
+
+DECLARE_CYCLE_STAT(TEXT("Replay Record Frame"), STAT_ReplayRecordFrame, STATGROUP_BMShooter);
+DECLARE_CYCLE_STAT(TEXT("Replay Dump"), STAT_ReplayDump, STATGROUP_BMShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Replay Buffer Bytes"), STAT_ReplayBufferBytes, STATGROUP_BMShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Replay Buffer Frames"), STAT_ReplayBufferFrames, STATGROUP_BMShooter);
+
+DEFINE_LOG_CATEGORY_STATIC(LogReplayBuffer, Log, All);
+
+// "BMRP" in the first bytes of the file
+static const uint32 ReplayMagic = 0x50524D42;
+static const uint16 ReplayVersion = 1;
+
+// streamed shots share the id space of the projectile actors
+static const uint32 SimulatedShotIdBit = 0x80000000;
+
+UReplayBufferSubsystem::UReplayBufferSubsystem() {
+	bufferSeconds = 60.0f;
+	clientBufferSeconds = 8.0f;
+	maxBufferBytes = 4 * 1024 * 1024;
+	maxClientBufferBytes = 640 * 1024;
+	frameRate = 20.0f;
+	keyframeInterval = 2.0f;
+	bRecordOnServer = true;
+	bRecordOnClient = true;
+	hitchThresholdMs = 100.0f;
+	hitchDumpCooldown = 60.0f;
+	killCamSeconds = 4.0f;
+}
+
+void UReplayBufferSubsystem::Initialize(FSubsystemCollectionBase& Collection) {
+	Super::Initialize(Collection);
+
+	UWorld* world = GetWorld();
+	const bool bClient = world && world->GetNetMode() == NM_Client;
+	if (world && world->IsGameWorld() && (bClient ? bRecordOnClient : bRecordOnServer)) {
+		// allocated once, recording never grows it
+		ring.SetNumUninitialized(FMath::Max(bClient ? maxClientBufferBytes : maxBufferBytes, 1024));
+	}
+
+	bInitialized = true;
+}
+
+void UReplayBufferSubsystem::Deinitialize() {
+	bInitialized = false;
+	StopKillCam();
+	ring.Empty();
+	frames.Empty();
+	characterIds.Empty();
+	characterNames.Empty();
+	Super::Deinitialize();
+}
+
+bool UReplayBufferSubsystem::IsTickable() const {
+	return bInitialized && (IsRecording() || killCamera != nullptr);
+}
+
+TStatId UReplayBufferSubsystem::GetStatId() const {
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UReplayBufferSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UReplayBufferSubsystem::GetTickableGameObjectWorld() const {
+	return GetWorld();
+}
+
+void UReplayBufferSubsystem::Tick(float DeltaTime) {
+	if (killCamera) {
+		UpdateKillCam(DeltaTime);
+	}
+
+	if (!IsRecording()) {
+		return;
+	}
+
+	timeUntilFrame -= DeltaTime;
+	if (timeUntilFrame <= 0.0f) {
+		timeUntilFrame += 1.0f / FMath::Max(frameRate, 1.0f);
+		RecordFrame();
+	}
+
+	// the frames before the hitch are already in the buffer, they are what explains it
+	const float now = GetWorld()->GetTimeSeconds();
+	const float gameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	if (hitchThresholdMs > 0.0f && gameThreadMs > hitchThresholdMs && !GetWorld()->IsNetMode(NM_Client) && now - lastHitchDumpTime >= hitchDumpCooldown) {
+		lastHitchDumpTime = now;
+		UE_LOG(LogReplayBuffer, Warning, TEXT("Frame took %.1f ms, dumping the replay buffer"), gameThreadMs);
+		DumpToDisk(TEXT("Hitch"));
+	}
+}
+
+uint32 UReplayBufferSubsystem::GetCharacterId(ABMShooterCharacter* character) {
+	uint32* id = characterIds.Find(character);
+	if (id) {
+		return *id;
+	}
+
+	const uint32 newId = nextCharacterId++;
+	characterIds.Add(character, newId);
+
+	const APlayerState* playerState = character->GetPlayerState();
+	characterNames.Emplace(newId, playerState ? playerState->GetPlayerName() : character->GetName());
+	return newId;
+}
+
+void UReplayBufferSubsystem::CaptureFrame(BMCombat::FReplayFrame& outFrame) {
+	outFrame.timeMs = (uint32)FMath::RoundToInt(GetWorld()->GetTimeSeconds() * 1000.0f);
+	outFrame.characters.clear();
+	outFrame.projectiles.clear();
+
+	for (TActorIterator<ABMShooterCharacter> it(GetWorld()); it; ++it) {
+		ABMShooterCharacter* character = *it;
+		if (character->IsPendingKill()) {
+			continue;
+		}
+
+		const FVector location = character->GetActorLocation();
+		BMCombat::FReplayCharacter record;
+		record.id = GetCharacterId(character);
+		record.x = FMath::RoundToInt(location.X);
+		record.y = FMath::RoundToInt(location.Y);
+		record.z = FMath::RoundToInt(location.Z);
+		record.yaw = FRotator::CompressAxisToShort(character->correctedRotation.Yaw);
+		record.pitch = FRotator::CompressAxisToShort(character->correctedRotation.Pitch);
+		record.health = character->healthComponent ? BMCombat::QuantizeHealth(character->healthComponent->GetNormalizedHealth(), 1.0f) : 0;
+		record.bDead = character->characterDead;
+		outFrame.characters.push_back(record);
+	}
+
+	// predicted projectiles are the client's guess, the replicated ones are the state
+	for (TActorIterator<ABMShooterProjectile> it(GetWorld()); it; ++it) {
+		const ABMShooterProjectile* projectile = *it;
+		if (projectile->IsPendingKill() || projectile->IsPredicted() || (projectile->IsPooled() && !projectile->GetLaunch().active)) {
+			continue;
+		}
+
+		const FVector location = projectile->GetActorLocation();
+		BMCombat::FReplayProjectile record;
+		record.id = projectile->GetUniqueID() & ~SimulatedShotIdBit;
+		record.x = FMath::RoundToInt(location.X);
+		record.y = FMath::RoundToInt(location.Y);
+		record.z = FMath::RoundToInt(location.Z);
+		outFrame.projectiles.push_back(record);
+	}
+
+	const UProjectileSimulationSubsystem* simulation = GetWorld()->GetSubsystem<UProjectileSimulationSubsystem>();
+	if (simulation) {
+		const TArray<FVector>& positions = simulation->GetPositions();
+		const TArray<uint32>& shotIds = simulation->GetShotIds();
+		for (int32 i = 0; i < positions.Num(); i++) {
+			BMCombat::FReplayProjectile record;
+			record.id = shotIds[i] | SimulatedShotIdBit;
+			record.x = FMath::RoundToInt(positions[i].X);
+			record.y = FMath::RoundToInt(positions[i].Y);
+			record.z = FMath::RoundToInt(positions[i].Z);
+			outFrame.projectiles.push_back(record);
+		}
+	}
+
+	// the codec matches entities with the previous frame by walking both in id order
+	std::sort(outFrame.characters.begin(), outFrame.characters.end(), [](const BMCombat::FReplayCharacter& a, const BMCombat::FReplayCharacter& b) {
+		return a.id < b.id;
+	});
+	std::sort(outFrame.projectiles.begin(), outFrame.projectiles.end(), [](const BMCombat::FReplayProjectile& a, const BMCombat::FReplayProjectile& b) {
+		return a.id < b.id;
+	});
+}
+
+void UReplayBufferSubsystem::RecordFrame() {
+	BM_SCOPE_CYCLE_COUNTER(STAT_ReplayRecordFrame);
+
+	const float now = GetWorld()->GetTimeSeconds();
+	CaptureFrame(currentFrame);
+
+	const bool bKeyframe = frames.Num() == 0 || now - lastKeyframeTime >= keyframeInterval;
+	encodedFrame.clear();
+	BMCombat::EncodeFrame(currentFrame, bKeyframe ? nullptr : &previousFrame, encodedFrame);
+	std::swap(previousFrame, currentFrame);
+
+	const int32 size = (int32)encodedFrame.size();
+	if (size > ring.Num()) {
+		// the frames after it could not be decoded, start over from a keyframe
+		frames.Reset();
+		return;
+	}
+
+	if (bKeyframe) {
+		lastKeyframeTime = now;
+	}
+
+	// copied in up to two pieces when it wraps around the end of the ring
+	const int32 start = (int32)(writePosition % ring.Num());
+	const int32 firstPart = FMath::Min(size, ring.Num() - start);
+	FMemory::Memcpy(ring.GetData() + start, encodedFrame.data(), firstPart);
+	FMemory::Memcpy(ring.GetData(), encodedFrame.data() + firstPart, size - firstPart);
+
+	FBMReplayFrameInfo& frame = frames.AddDefaulted_GetRef();
+	frame.time = now;
+	frame.start = writePosition;
+	frame.size = size;
+	frame.bKeyframe = bKeyframe;
+	writePosition += size;
+
+	EvictFrames(now);
+
+	SET_DWORD_STAT(STAT_ReplayBufferBytes, frames.Num() > 0 ? writePosition - frames[0].start : 0);
+	SET_DWORD_STAT(STAT_ReplayBufferFrames, frames.Num());
+}
+
+void UReplayBufferSubsystem::EvictFrames(float now) {
+	const int64 oldestValidByte = writePosition - ring.Num();
+	const float maxAge = GetWorld()->IsNetMode(NM_Client) ? clientBufferSeconds : bufferSeconds;
+
+	int32 numEvicted = 0;
+	while (numEvicted < frames.Num() && (frames[numEvicted].start < oldestValidByte || now - frames[numEvicted].time > maxAge)) {
+		numEvicted++;
+	}
+
+	// delta frames are useless without the keyframe they started from
+	if (numEvicted > 0) {
+		while (numEvicted < frames.Num() && !frames[numEvicted].bKeyframe) {
+			numEvicted++;
+		}
+	}
+	frames.RemoveAt(0, numEvicted, false);
+}
+
+void UReplayBufferSubsystem::ReadFrame(const FBMReplayFrameInfo& frame, TArray<uint8>& outData) const {
+	outData.SetNumUninitialized(frame.size, false);
+
+	const int32 start = (int32)(frame.start % ring.Num());
+	const int32 firstPart = FMath::Min(frame.size, ring.Num() - start);
+	FMemory::Memcpy(outData.GetData(), ring.GetData() + start, firstPart);
+	FMemory::Memcpy(outData.GetData() + firstPart, ring.GetData(), frame.size - firstPart);
+}
+
+void UReplayBufferSubsystem::DumpToDisk(const FString& reason) {
+	BM_SCOPE_CYCLE_COUNTER(STAT_ReplayDump);
+
+	if (frames.Num() == 0) {
+		UE_LOG(LogReplayBuffer, Log, TEXT("Replay buffer is empty, nothing to dump"));
+		return;
+	}
+
+	TArray<uint8> data;
+	data.Reserve(writePosition - frames[0].start + 1024);
+	FMemoryWriter writer(data);
+
+	uint32 magic = ReplayMagic;
+	uint16 version = ReplayVersion;
+	int32 numNames = characterNames.Num();
+	int32 numFrames = frames.Num();
+	writer << magic << version << numNames;
+	for (TPair<uint32, FString>& name : characterNames) {
+		writer << name.Key << name.Value;
+	}
+
+	// each frame as its size and bytes, the first one is a keyframe
+	writer << numFrames;
+	TArray<uint8> frameData;
+	for (const FBMReplayFrameInfo& frame : frames) {
+		ReadFrame(frame, frameData);
+		int32 size = frameData.Num();
+		writer << size;
+		writer.Serialize(frameData.GetData(), size);
+	}
+
+	const FString path = FPaths::ProjectSavedDir() / TEXT("Replays") / FString::Printf(TEXT("Replay_%s_%s_%s.bmreplay"), *GetWorld()->GetMapName(), *FDateTime::Now().ToString(), *reason);
+	UE_LOG(LogReplayBuffer, Log, TEXT("Writing %d replay frames (%.1f s, %d KB) to %s"), numFrames, frames.Last().time - frames[0].time, data.Num() / 1024, *path);
+
+	// writing can take longer than a frame, the game thread only pays for the copy
+	Async(EAsyncExecution::ThreadPool, [data = MoveTemp(data), path]() {
+		FFileHelper::SaveArrayToFile(data, *path);
+	});
+}
+
+void UReplayBufferSubsystem::StartKillCam(ABMShooterCharacter* victim, ABMShooterCharacter* killer) {
+	StopKillCam();
+
+	if (!IsRecording() || !victim || !killer || killer == victim) {
+		return;
+	}
+
+	APlayerController* controller = Cast<APlayerController>(victim->GetController());
+	const uint32* killerId = characterIds.Find(killer);
+	if (!controller || !controller->IsLocalController() || !killerId) {
+		return;
+	}
+
+	// the moment of the death goes in too
+	RecordFrame();
+
+	// decoding has to start from the last keyframe before the window
+	const float windowStart = GetWorld()->GetTimeSeconds() - killCamSeconds;
+	int32 firstFrame = 0;
+	for (int32 i = 0; i < frames.Num() && frames[i].time <= windowStart; i++) {
+		if (frames[i].bKeyframe) {
+			firstFrame = i;
+		}
+	}
+
+	killCamSamples.Reset();
+	TArray<uint8> frameData;
+	BMCombat::FReplayFrame previous;
+	BMCombat::FReplayFrame decoded;
+	for (int32 i = firstFrame; i < frames.Num(); i++) {
+		ReadFrame(frames[i], frameData);
+		size_t offset = 0;
+		if (!BMCombat::DecodeFrame(frameData.GetData(), frameData.Num(), offset, i > firstFrame ? &previous : nullptr, decoded)) {
+			break;
+		}
+		std::swap(previous, decoded);
+
+		if (frames[i].time < windowStart) {
+			continue;
+		}
+
+		for (const BMCombat::FReplayCharacter& character : previous.characters) {
+			if (character.id == *killerId) {
+				FBMKillCamSample& sample = killCamSamples.AddDefaulted_GetRef();
+				sample.time = frames[i].time;
+				sample.location = FVector(character.x, character.y, character.z + killer->BaseEyeHeight);
+				sample.rotation = FRotator(FRotator::DecompressAxisFromShort(character.pitch), FRotator::DecompressAxisFromShort(character.yaw), 0.0f);
+				break;
+			}
+		}
+	}
+
+	if (killCamSamples.Num() < 2) {
+		return;
+	}
+
+	FActorSpawnParameters spawnParams;
+	spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	spawnParams.ObjectFlags |= RF_Transient;
+	killCamera = GetWorld()->SpawnActor<ACameraActor>(killCamSamples[0].location, killCamSamples[0].rotation, spawnParams);
+	if (!killCamera) {
+		return;
+	}
+
+	killCamController = controller;
+	killCamTime = killCamSamples[0].time;
+	controller->SetViewTargetWithBlend(killCamera, 0.25f);
+}
+
+void UReplayBufferSubsystem::UpdateKillCam(float DeltaTime) {
+	killCamTime += DeltaTime;
+	if (!killCamController.IsValid() || killCamTime >= killCamSamples.Last().time) {
+		StopKillCam();
+		return;
+	}
+
+	// samples are a recorded frame apart, the camera moves between them
+	int32 next = 1;
+	while (next < killCamSamples.Num() - 1 && killCamSamples[next].time < killCamTime) {
+		next++;
+	}
+	const FBMKillCamSample& from = killCamSamples[next - 1];
+	const FBMKillCamSample& to = killCamSamples[next];
+	const float alpha = FMath::Clamp((killCamTime - from.time) / FMath::Max(to.time - from.time, KINDA_SMALL_NUMBER), 0.0f, 1.0f);
+
+	killCamera->SetActorLocationAndRotation(FMath::Lerp(from.location, to.location, alpha), FQuat::Slerp(from.rotation.Quaternion(), to.rotation.Quaternion(), alpha));
+}
+
+void UReplayBufferSubsystem::StopKillCam() {
+	if (!killCamera) {
+		return;
+	}
+
+	APlayerController* controller = killCamController.Get();
+	if (controller && controller->GetViewTarget() == killCamera) {
+		APawn* pawn = controller->GetPawn();
+		controller->SetViewTargetWithBlend(pawn ? (AActor*)pawn : (AActor*)controller, 0.25f);
+	}
+
+	if (IsValid(killCamera)) {
+		killCamera->Destroy();
+	}
+	killCamera = nullptr;
+	killCamController.Reset();
+	killCamSamples.Reset();
+}
+
+#if !UE_BUILD_SHIPPING
+// Writes the replay buffer of the world to Saved/Replays
+static FAutoConsoleCommandWithWorldAndArgs ReplayDumpCommand(
+	TEXT("bm.ReplayDump"),
+	TEXT("bm.ReplayDump: writes the last seconds of the replay buffer to Saved/Replays"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& args, UWorld* world) {
+		UReplayBufferSubsystem* replayBuffer = world ? world->GetSubsystem<UReplayBufferSubsystem>() : nullptr;
+		if (replayBuffer) {
+			replayBuffer->DumpToDisk(TEXT("Manual"));
+		}
+	})
+);
+#endif
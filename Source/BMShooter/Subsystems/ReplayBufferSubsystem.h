@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "CombatCore/ReplayCodec.h"
+#include "ReplayBufferSubsystem.generated.h"
+
+class ABMShooterCharacter;
+class ACameraActor;
+
+// Where a recorded frame is in the ring
+struct FBMReplayFrameInfo
+{
+	float time = 0.0f;
+	int64 start = 0;
+	int32 size = 0;
+	bool bKeyframe = false;
+};
+
+// A point of view of the kill cam
+struct FBMKillCamSample
+{
+	float time = 0.0f;
+	FVector location;
+	FRotator rotation;
+};
+
+/**
+ * Records the replicated state of the characters and projectiles a few times per second into a fixed size ring of
+ * delta compressed frames, so the last bufferSeconds can be written to Saved/Replays on demand (bm.ReplayDump) or
+ * when a frame goes over hitchThresholdMs. Servers record with bRecordOnServer, clients with bRecordOnClient and play
+ * the kill cam from their own buffer, following the view of the killer over the seconds before the death.
+ */
+UCLASS(config=Game)
+class BMSHOOTER_API UReplayBufferSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UReplayBufferSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+	// Writes the frames in the buffer to Saved/Replays off the game thread, reason ends up in the file name
+	void DumpToDisk(const FString& reason);
+
+	// Client: plays the last killCamSeconds from the killer's view on the victim's controller
+	void StartKillCam(ABMShooterCharacter* victim, ABMShooterCharacter* killer);
+
+	void StopKillCam();
+
+	FORCEINLINE bool IsRecording() const { return ring.Num() > 0; }
+
+	// Seconds of frames kept on a server
+	UPROPERTY(config)
+	float bufferSeconds;
+
+	// Seconds of frames kept on a client, only the kill cam reads them
+	UPROPERTY(config)
+	float clientBufferSeconds;
+
+	// Size of the ring on a server, the oldest frames go early if it fills up before bufferSeconds
+	UPROPERTY(config)
+	int32 maxBufferBytes;
+
+	// Size of the ring on a client, enough for clientBufferSeconds at the server's rate
+	UPROPERTY(config)
+	int32 maxClientBufferBytes;
+
+	// Frames recorded per second
+	UPROPERTY(config)
+	float frameRate;
+
+	// Seconds between keyframes, the buffer drops whole keyframe groups
+	UPROPERTY(config)
+	float keyframeInterval;
+
+	UPROPERTY(config)
+	bool bRecordOnServer;
+
+	UPROPERTY(config)
+	bool bRecordOnClient;
+
+	// Game thread time of a frame that triggers a dump, 0 for none
+	UPROPERTY(config)
+	float hitchThresholdMs;
+
+	// Min seconds between two dumps triggered by hitches
+	UPROPERTY(config)
+	float hitchDumpCooldown;
+
+	UPROPERTY(config)
+	float killCamSeconds;
+
+protected:
+	void RecordFrame();
+
+	void CaptureFrame(BMCombat::FReplayFrame& outFrame);
+
+	uint32 GetCharacterId(ABMShooterCharacter* character);
+
+	// Drops the frames the ring wrote over or that are older than the buffer, then up to the next keyframe
+	void EvictFrames(float now);
+
+	// Copies the bytes of a frame out of the ring
+	void ReadFrame(const FBMReplayFrameInfo& frame, TArray<uint8>& outData) const;
+
+	void UpdateKillCam(float DeltaTime);
+
+protected:
+	TArray<uint8> ring;
+	int64 writePosition = 0;
+	TArray<FBMReplayFrameInfo> frames;
+
+	BMCombat::FReplayFrame previousFrame;
+	BMCombat::FReplayFrame currentFrame;
+	std::vector<uint8_t> encodedFrame;
+
+	TMap<TWeakObjectPtr<ABMShooterCharacter>, uint32> characterIds;
+	// id and name of every character recorded, written with the dump
+	TArray<TPair<uint32, FString>> characterNames;
+	uint32 nextCharacterId = 1;
+
+	float timeUntilFrame = 0.0f;
+	float lastKeyframeTime = -BIG_NUMBER;
+	float lastHitchDumpTime = -BIG_NUMBER;
+
+	UPROPERTY()
+	ACameraActor* killCamera;
+
+	TArray<FBMKillCamSample> killCamSamples;
+	TWeakObjectPtr<APlayerController> killCamController;
+	float killCamTime = 0.0f;
+
+	bool bInitialized = false;
+};
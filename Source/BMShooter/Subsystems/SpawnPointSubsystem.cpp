@@ -0,0 +1,197 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpawnPointSubsystem.h"
+#include "BMShooterCharacter.h"
+#include "Subsystems/CharacterSpatialHashSubsystem.h"
+#include "NavigationSystem.h"
+#include "Engine/World.h"
+#include "BMShooterStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Spawn Points Pick"), STAT_SpawnPointPick, STATGROUP_BMShooter);
+DECLARE_CYCLE_STAT(TEXT("Spawn Points Refresh"), STAT_SpawnPointRefresh, STATGROUP_BMShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Spawn Points"), STAT_SpawnPoints, STATGROUP_BMShooter);
+
+DEFINE_LOG_CATEGORY_STATIC(LogSpawnPoints, Log, All);
+
+USpawnPointSubsystem::USpawnPointSubsystem() {
+	numSpawnPoints = 64;
+	pointsPerTick = 4;
+	maxPickAttempts = 8;
+	minEnemyDistance = 1500.0f;
+}
+
+void USpawnPointSubsystem::Initialize(FSubsystemCollectionBase& Collection) {
+	Super::Initialize(Collection);
+	bInitialized = true;
+}
+
+void USpawnPointSubsystem::Deinitialize() {
+	bInitialized = false;
+
+	UNavigationSystemV1* navigationSystem = UNavigationSystemV1::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (navigationSystem) {
+		navigationSystem->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &USpawnPointSubsystem::OnNavigationGenerationFinished);
+	}
+
+	spawnPoints.Empty();
+	pendingSpawnPoints.Empty();
+	pickOrder.Empty();
+	Super::Deinitialize();
+}
+
+bool USpawnPointSubsystem::IsTickable() const {
+	return bInitialized && (bWaitingForNavigation || bRefreshing);
+}
+
+TStatId USpawnPointSubsystem::GetStatId() const {
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USpawnPointSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* USpawnPointSubsystem::GetTickableGameObjectWorld() const {
+	return GetWorld();
+}
+
+void USpawnPointSubsystem::Tick(float DeltaTime) {
+	if (bWaitingForNavigation) {
+		UWorld* world = GetWorld();
+		if (world->IsNetMode(NM_Client)) {
+			// clients never respawn anyone
+			bWaitingForNavigation = false;
+			return;
+		}
+
+		// the navigation system is created after the world subsystems
+		UNavigationSystemV1* navigationSystem = UNavigationSystemV1::GetCurrent<UNavigationSystemV1>(world);
+		if (!navigationSystem) {
+			return;
+		}
+
+		navigationSystem->OnNavigationGenerationFinishedDelegate.AddUniqueDynamic(this, &USpawnPointSubsystem::OnNavigationGenerationFinished);
+		bWaitingForNavigation = false;
+		RequestRefresh();
+	}
+
+	if (bRefreshing) {
+		RefreshStep();
+	}
+}
+
+void USpawnPointSubsystem::RequestRefresh() {
+	pendingSpawnPoints.Reset();
+	refreshAttempts = 0;
+	bRefreshing = true;
+}
+
+void USpawnPointSubsystem::OnNavigationGenerationFinished(ANavigationData* navData) {
+	RequestRefresh();
+}
+
+bool USpawnPointSubsystem::FindGroundPoint(FVector& outLocation) const {
+	UWorld* world = GetWorld();
+	UNavigationSystemV1* navigationSystem = UNavigationSystemV1::GetCurrent<UNavigationSystemV1>(world);
+	FNavLocation navLocation;
+	if (!navigationSystem || !navigationSystem->GetRandomPoint(navLocation)) {
+		return false;
+	}
+
+	// the navmesh floats above the floor, trace down to the geometry it was built from
+	FHitResult hit;
+	const FVector start = navLocation.Location + FVector(0.0f, 0.0f, 100.0f);
+	const FVector end = navLocation.Location - FVector(0.0f, 0.0f, 500.0f);
+	if (!world->LineTraceSingleByObjectType(hit, start, end, FCollisionObjectQueryParams(ECC_WorldStatic))) {
+		return false;
+	}
+
+	outLocation = hit.ImpactPoint;
+	return true;
+}
+
+void USpawnPointSubsystem::RefreshStep() {
+	BM_SCOPE_CYCLE_COUNTER(STAT_SpawnPointRefresh);
+
+	const int32 maxAttempts = numSpawnPoints * 4;
+	for (int32 i = 0; i < pointsPerTick && pendingSpawnPoints.Num() < numSpawnPoints && refreshAttempts < maxAttempts; i++) {
+		refreshAttempts++;
+
+		FVector location;
+		if (FindGroundPoint(location)) {
+			pendingSpawnPoints.Add(location);
+		}
+	}
+
+	if (pendingSpawnPoints.Num() < numSpawnPoints && refreshAttempts < maxAttempts) {
+		return;
+	}
+
+	bRefreshing = false;
+	if (pendingSpawnPoints.Num() == 0) {
+		UE_LOG(LogSpawnPoints, Warning, TEXT("No spawn points found on the navmesh, keeping %d old points"), spawnPoints.Num());
+		return;
+	}
+
+	Swap(spawnPoints, pendingSpawnPoints);
+	pendingSpawnPoints.Reset();
+	Shuffle();
+	SET_DWORD_STAT(STAT_SpawnPoints, spawnPoints.Num());
+	UE_LOG(LogSpawnPoints, Log, TEXT("Cached %d spawn points"), spawnPoints.Num());
+}
+
+void USpawnPointSubsystem::Shuffle() {
+	pickOrder.SetNumUninitialized(spawnPoints.Num());
+	for (int32 i = 0; i < pickOrder.Num(); i++) {
+		pickOrder[i] = i;
+	}
+	for (int32 i = pickOrder.Num() - 1; i > 0; i--) {
+		pickOrder.Swap(i, FMath::RandRange(0, i));
+	}
+	pickCursor = 0;
+}
+
+float USpawnPointSubsystem::GetClosestDistSquared(const FVector& location) const {
+	const UCharacterSpatialHashSubsystem* characterHash = GetWorld()->GetSubsystem<UCharacterSpatialHashSubsystem>();
+	float closest = characterHash ? characterHash->ClosestDistSquared(location, minEnemyDistance) : FMath::Square(minEnemyDistance);
+
+	for (const FVector& other : frameSpawnLocations) {
+		closest = FMath::Min(closest, FVector::DistSquared(location, other));
+	}
+	return closest;
+}
+
+bool USpawnPointSubsystem::PickSpawnPoint(const ABMShooterCharacter* character, FVector& outLocation) {
+	BM_SCOPE_CYCLE_COUNTER(STAT_SpawnPointPick);
+
+	if (spawnPoints.Num() == 0) {
+		// nothing cached yet, fall back to a single navmesh query
+		return FindGroundPoint(outLocation);
+	}
+
+	if (frameSpawnFrame != GFrameCounter) {
+		frameSpawnFrame = GFrameCounter;
+		frameSpawnLocations.Reset();
+	}
+
+	const float minDistanceSquared = FMath::Square(minEnemyDistance);
+	float bestDistanceSquared = -1.0f;
+	const int32 attempts = FMath::Min(maxPickAttempts, spawnPoints.Num());
+	for (int32 i = 0; i < attempts; i++) {
+		if (pickCursor >= pickOrder.Num()) {
+			Shuffle();
+		}
+
+		const FVector& candidate = spawnPoints[pickOrder[pickCursor++]];
+		const float distanceSquared = GetClosestDistSquared(candidate);
+		if (distanceSquared > bestDistanceSquared) {
+			bestDistanceSquared = distanceSquared;
+			outLocation = candidate;
+		}
+
+		if (distanceSquared >= minDistanceSquared) {
+			break;
+		}
+	}
+
+	// characters respawned later this frame keep away from this one too
+	frameSpawnLocations.Add(outLocation);
+	return true;
+}
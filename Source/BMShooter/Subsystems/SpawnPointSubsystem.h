@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "SpawnPointSubsystem.generated.h"
+
+class ABMShooterCharacter;
+class ANavigationData;
+
+/**
+ * Server side cache of respawn locations. Random navmesh points are projected to the ground once, a few per tick,
+ * when the map loads and every time the navmesh is rebuilt. Respawns walk a shuffled cursor over the cache and take
+ * the first point with no living enemy close to it.
+ */
+UCLASS(config=Game)
+class BMSHOOTER_API USpawnPointSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	USpawnPointSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+	/**
+	 * Picks a ground location to respawn the character at.
+	 * @return false if the cache is empty and no navmesh point could be found either
+	 */
+	bool PickSpawnPoint(const ABMShooterCharacter* character, FVector& outLocation);
+
+	// Starts rebuilding the cache over the next ticks, the current points are used until it finishes
+	void RequestRefresh();
+
+	FORCEINLINE int32 GetNumSpawnPoints() const { return spawnPoints.Num(); }
+
+	// Spawn points kept in the cache
+	UPROPERTY(config)
+	int32 numSpawnPoints;
+
+	// Navmesh points projected per tick while refreshing
+	UPROPERTY(config)
+	int32 pointsPerTick;
+
+	// Points looked at per respawn before taking the best one seen
+	UPROPERTY(config)
+	int32 maxPickAttempts;
+
+	// Points with a living enemy closer than this are skipped
+	UPROPERTY(config)
+	float minEnemyDistance;
+
+protected:
+	UFUNCTION()
+	void OnNavigationGenerationFinished(ANavigationData* navData);
+
+	// Random navmesh point projected down to the floor
+	bool FindGroundPoint(FVector& outLocation) const;
+
+	void RefreshStep();
+
+	void Shuffle();
+
+	// Squared distance to the closest living enemy, or to a point picked earlier this frame
+	float GetClosestDistSquared(const FVector& location) const;
+
+protected:
+	TArray<FVector> spawnPoints;
+
+	// shuffled indices into spawnPoints, reshuffled every time the cursor wraps
+	TArray<int32> pickOrder;
+	int32 pickCursor = 0;
+
+	// points of the refresh in progress
+	TArray<FVector> pendingSpawnPoints;
+	int32 refreshAttempts = 0;
+	bool bRefreshing = false;
+
+	// points picked this frame, characters respawned together keep away from each other too
+	TArray<FVector> frameSpawnLocations;
+	uint64 frameSpawnFrame = 0;
+
+	bool bWaitingForNavigation = true;
+
+	bool bInitialized = false;
+};
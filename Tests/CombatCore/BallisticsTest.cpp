@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatCore/Ballistics.h"
+
+#include <gtest/gtest.h>
+
+using namespace BMCombat;
+
+namespace
+{
+	void ExpectVectorNear(const FVec3& actual, const FVec3& expected) {
+		EXPECT_NEAR(actual.X, expected.X, 1e-3f);
+		EXPECT_NEAR(actual.Y, expected.Y, 1e-3f);
+		EXPECT_NEAR(actual.Z, expected.Z, 1e-3f);
+	}
+}
+
+TEST(Ballistics, IntegrateVelocityGravity) {
+	FBallisticParams params;
+	params.gravityZ = -980.0f;
+	params.maxSpeed = 0.0f;
+
+	ExpectVectorNear(IntegrateVelocity(FVec3(100.0f, 0.0f, 0.0f), params, 0.5f), FVec3(100.0f, 0.0f, -490.0f));
+}
+
+TEST(Ballistics, IntegrateVelocityMaxSpeed) {
+	FBallisticParams params;
+	params.maxSpeed = 3000.0f;
+
+	// over maxSpeed keeps the direction
+	ExpectVectorNear(IntegrateVelocity(FVec3(6000.0f, 0.0f, 8000.0f), params, 0.016f), FVec3(1800.0f, 0.0f, 2400.0f));
+	// under it is left alone
+	ExpectVectorNear(IntegrateVelocity(FVec3(1000.0f, 0.0f, 0.0f), params, 0.016f), FVec3(1000.0f, 0.0f, 0.0f));
+}
+
+TEST(Ballistics, ComputeBounce) {
+	FBallisticParams params;
+	params.bounciness = 0.6f;
+	params.friction = 0.2f;
+	params.bounceStopSpeed = 5.0f;
+
+	// the normal part is reflected scaled by bounciness, the tangent part loses friction
+	FVec3 bounced;
+	EXPECT_TRUE(ComputeBounce(FVec3(100.0f, 0.0f, -100.0f), FVec3(0.0f, 0.0f, 1.0f), params, bounced));
+	ExpectVectorNear(bounced, FVec3(80.0f, 0.0f, 60.0f));
+
+	// moving away from the surface doesn't change the velocity
+	EXPECT_TRUE(ComputeBounce(FVec3(100.0f, 0.0f, 10.0f), FVec3(0.0f, 0.0f, 1.0f), params, bounced));
+	ExpectVectorNear(bounced, FVec3(100.0f, 0.0f, 10.0f));
+}
+
+TEST(Ballistics, ComputeBounceStopsBelowThreshold) {
+	FBallisticParams params;
+	params.bounciness = 0.6f;
+	params.friction = 0.2f;
+	params.bounceStopSpeed = 5.0f;
+
+	// bounces off at 3 uu/s, under bounceStopSpeed
+	FVec3 bounced;
+	EXPECT_FALSE(ComputeBounce(FVec3(0.0f, 0.0f, -5.0f), FVec3(0.0f, 0.0f, 1.0f), params, bounced));
+	ExpectVectorNear(bounced, FVec3(0.0f, 0.0f, 3.0f));
+
+	// right at the threshold keeps flying
+	params.bounceStopSpeed = 3.0f;
+	EXPECT_TRUE(ComputeBounce(FVec3(0.0f, 0.0f, -5.0f), FVec3(0.0f, 0.0f, 1.0f), params, bounced));
+}
+
+TEST(Ballistics, ComputeBounceDisabled) {
+	FBallisticParams params;
+	params.bShouldBounce = false;
+
+	FVec3 bounced;
+	EXPECT_FALSE(ComputeBounce(FVec3(100.0f, 0.0f, -100.0f), FVec3(0.0f, 0.0f, 1.0f), params, bounced));
+}
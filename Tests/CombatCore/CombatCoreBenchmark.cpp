@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatCore/Ballistics.h"
+#include "CombatCore/CombatRules.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace BMCombat;
+
+// Hits of a tick spread over 64 victims, like a full server under fire
+static void BM_ResolveHits(benchmark::State& state) {
+	const int32_t numHits = (int32_t)state.range(0);
+	const int32_t numVictims = 64;
+
+	std::mt19937 random(1234);
+	std::uniform_int_distribution<int32_t> victim(0, numVictims - 1);
+	std::vector<FHit> hits(numHits);
+	for (FHit& hit : hits) {
+		hit.victim = victim(random);
+		hit.damage = 10.0f;
+	}
+
+	std::vector<int32_t> victimSlots;
+	std::vector<int32_t> victims;
+	std::vector<FDamageTotal> totals;
+	for (auto _ : state) {
+		ResolveHits(hits, numVictims, victimSlots, victims, totals);
+		benchmark::DoNotOptimize(totals.data());
+	}
+	state.SetItemsProcessed(state.iterations() * numHits);
+}
+BENCHMARK(BM_ResolveHits)->RangeMultiplier(4)->Range(64, 16384);
+
+// A second of flight of every projectile, bouncing the ones that go under the floor. Every iteration steps a fresh
+// copy of the launch state so the projectiles don't come to rest and leave idle work to time
+static void BM_BallisticStep(benchmark::State& state) {
+	const int32_t numProjectiles = (int32_t)state.range(0);
+	const int32_t numSteps = 60;
+	const float deltaTime = 1.0f / 60.0f;
+
+	FBallisticParams params;
+	params.gravityZ = -980.0f;
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+	const std::vector<FVec3> launchPositions(numProjectiles, FVec3(0.0f, 0.0f, 200.0f));
+	std::vector<FVec3> launchVelocities(numProjectiles);
+	for (FVec3& velocity : launchVelocities) {
+		velocity = FVec3(direction(random), direction(random), direction(random)) * params.initialSpeed;
+	}
+
+	const FVec3 floorNormal(0.0f, 0.0f, 1.0f);
+	std::vector<FVec3> positions;
+	std::vector<FVec3> velocities;
+	for (auto _ : state) {
+		// copying into the same buffers doesn't allocate and is cheap next to the steps
+		positions = launchPositions;
+		velocities = launchVelocities;
+		for (int32_t step = 0; step < numSteps; step++) {
+			for (int32_t i = 0; i < numProjectiles; i++) {
+				velocities[i] = IntegrateVelocity(velocities[i], params, deltaTime);
+				positions[i] += velocities[i] * deltaTime;
+				if (positions[i].Z < 0.0f) {
+					positions[i].Z = 0.0f;
+					FVec3 bounced;
+					velocities[i] = ComputeBounce(velocities[i], floorNormal, params, bounced) ? bounced : FVec3(0.0f, 0.0f, 0.0f);
+				}
+			}
+			benchmark::ClobberMemory();
+		}
+		benchmark::DoNotOptimize(positions.data());
+	}
+	state.SetItemsProcessed(state.iterations() * numProjectiles * numSteps);
+}
+BENCHMARK(BM_BallisticStep)->RangeMultiplier(4)->Range(64, 16384);
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatCore/CombatRules.h"
+
+#include <gtest/gtest.h>
+
+using namespace BMCombat;
+
+TEST(CombatRules, ClampHealth) {
+	EXPECT_FLOAT_EQ(ClampHealth(50.0f, 100.0f), 50.0f);
+	EXPECT_FLOAT_EQ(ClampHealth(-10.0f, 100.0f), 0.0f);
+	EXPECT_FLOAT_EQ(ClampHealth(150.0f, 100.0f), 100.0f);
+}
+
+TEST(CombatRules, QuantizeHealth) {
+	EXPECT_EQ(QuantizeHealth(0.0f, 100.0f), 0);
+	EXPECT_EQ(QuantizeHealth(100.0f, 100.0f), UINT16_MAX);
+	// out of range health and a zero max don't wrap
+	EXPECT_EQ(QuantizeHealth(-5.0f, 100.0f), 0);
+	EXPECT_EQ(QuantizeHealth(200.0f, 100.0f), UINT16_MAX);
+	EXPECT_EQ(QuantizeHealth(50.0f, 0.0f), 0);
+
+	// a round trip is off by half a step at most
+	for (float health = 0.0f; health <= 100.0f; health += 0.37f) {
+		EXPECT_NEAR(DequantizeHealth(QuantizeHealth(health, 100.0f), 100.0f), health, 100.0f / UINT16_MAX);
+	}
+}
+
+TEST(CombatRules, ShouldDie) {
+	EXPECT_TRUE(ShouldDie(0.0f, false));
+	EXPECT_TRUE(ShouldDie(-1.0f, false));
+	EXPECT_FALSE(ShouldDie(1.0f, false));
+	EXPECT_FALSE(ShouldDie(0.0f, true));
+}
+
+TEST(CombatRules, Respawn) {
+	EXPECT_FLOAT_EQ(GetRespawnTime(10.0f, 3.0f), 13.0f);
+	// a negative delay respawns right away
+	EXPECT_FLOAT_EQ(GetRespawnTime(10.0f, -3.0f), 10.0f);
+
+	EXPECT_FALSE(IsRespawnDue(12.9f, 13.0f));
+	EXPECT_TRUE(IsRespawnDue(13.0f, 13.0f));
+	EXPECT_TRUE(IsRespawnDue(14.0f, 13.0f));
+}
+
+TEST(CombatRules, AccumulateHit) {
+	FDamageTotal total;
+	AccumulateHit(total, 10.0f, 0);
+	AccumulateHit(total, 15.0f, 3);
+
+	EXPECT_FLOAT_EQ(total.damage, 25.0f);
+	EXPECT_EQ(total.numHits, 2);
+	EXPECT_EQ(total.lastHit, 3);
+}
+
+TEST(CombatRules, ResolveHits) {
+	const std::vector<FHit> hits = { { 2, 10.0f }, { 0, 5.0f }, { 2, 20.0f }, { 7, 99.0f }, { -1, 99.0f }, { 0, 1.0f } };
+	std::vector<int32_t> victimSlots;
+	std::vector<int32_t> victims;
+	std::vector<FDamageTotal> totals;
+	ResolveHits(hits, 3, victimSlots, victims, totals);
+
+	// out of range victims are dropped, the others keep the order of their first hit
+	ASSERT_EQ(victims.size(), 2u);
+	ASSERT_EQ(totals.size(), 2u);
+	EXPECT_EQ(victims[0], 2);
+	EXPECT_EQ(victims[1], 0);
+
+	EXPECT_FLOAT_EQ(totals[0].damage, 30.0f);
+	EXPECT_EQ(totals[0].numHits, 2);
+	EXPECT_EQ(totals[0].lastHit, 2);
+
+	EXPECT_FLOAT_EQ(totals[1].damage, 6.0f);
+	EXPECT_EQ(totals[1].numHits, 2);
+	EXPECT_EQ(totals[1].lastHit, 5);
+
+	// the buffers get reused by the next resolve
+	ResolveHits({ { 1, 4.0f } }, 3, victimSlots, victims, totals);
+	ASSERT_EQ(victims.size(), 1u);
+	EXPECT_EQ(victims[0], 1);
+	EXPECT_FLOAT_EQ(totals[0].damage, 4.0f);
+}
+
+TEST(CombatRules, ResolveHitsEmpty) {
+	std::vector<int32_t> victimSlots;
+	std::vector<int32_t> victims = { 1 };
+	std::vector<FDamageTotal> totals(1);
+	ResolveHits({}, 4, victimSlots, victims, totals);
+
+	EXPECT_TRUE(victims.empty());
+	EXPECT_TRUE(totals.empty());
+}
+
+TEST(CombatRules, GetRadialDamage) {
+	FRadialDamage radial;
+	radial.baseDamage = 100.0f;
+	radial.minDamage = 20.0f;
+	radial.innerRadius = 100.0f;
+	radial.outerRadius = 300.0f;
+	radial.falloff = 1.0f;
+
+	EXPECT_FLOAT_EQ(GetRadialDamage(radial, 0.0f), 100.0f);
+	EXPECT_FLOAT_EQ(GetRadialDamage(radial, 100.0f), 100.0f);
+	EXPECT_FLOAT_EQ(GetRadialDamage(radial, 200.0f), 60.0f);
+	EXPECT_FLOAT_EQ(GetRadialDamage(radial, 300.0f), 20.0f);
+	EXPECT_FLOAT_EQ(GetRadialDamage(radial, 300.1f), 0.0f);
+
+	// a higher falloff drops off sooner
+	radial.falloff = 2.0f;
+	EXPECT_FLOAT_EQ(GetRadialDamage(radial, 200.0f), 40.0f);
+
+	// no inner radius range doesn't divide by zero
+	radial.innerRadius = radial.outerRadius;
+	EXPECT_FLOAT_EQ(GetRadialDamage(radial, 300.0f), 100.0f);
+}
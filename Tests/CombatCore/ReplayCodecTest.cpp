@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatCore/ReplayCodec.h"
+
+#include <gtest/gtest.h>
+
+using namespace BMCombat;
+
+namespace
+{
+	FReplayCharacter MakeCharacter(uint32_t id, int32_t x, int32_t y, int32_t z, uint16_t yaw, uint16_t health, bool bDead) {
+		FReplayCharacter character;
+		character.id = id;
+		character.x = x;
+		character.y = y;
+		character.z = z;
+		character.yaw = yaw;
+		character.pitch = (uint16_t)(yaw / 2);
+		character.health = health;
+		character.bDead = bDead;
+		return character;
+	}
+
+	FReplayProjectile MakeProjectile(uint32_t id, int32_t x, int32_t y, int32_t z) {
+		FReplayProjectile projectile;
+		projectile.id = id;
+		projectile.x = x;
+		projectile.y = y;
+		projectile.z = z;
+		return projectile;
+	}
+
+	void ExpectFramesEqual(const FReplayFrame& actual, const FReplayFrame& expected) {
+		EXPECT_EQ(actual.timeMs, expected.timeMs);
+		ASSERT_EQ(actual.characters.size(), expected.characters.size());
+		for (size_t i = 0; i < expected.characters.size(); i++) {
+			EXPECT_EQ(actual.characters[i].id, expected.characters[i].id);
+			EXPECT_EQ(actual.characters[i].x, expected.characters[i].x);
+			EXPECT_EQ(actual.characters[i].y, expected.characters[i].y);
+			EXPECT_EQ(actual.characters[i].z, expected.characters[i].z);
+			EXPECT_EQ(actual.characters[i].yaw, expected.characters[i].yaw);
+			EXPECT_EQ(actual.characters[i].pitch, expected.characters[i].pitch);
+			EXPECT_EQ(actual.characters[i].health, expected.characters[i].health);
+			EXPECT_EQ(actual.characters[i].bDead, expected.characters[i].bDead);
+		}
+		ASSERT_EQ(actual.projectiles.size(), expected.projectiles.size());
+		for (size_t i = 0; i < expected.projectiles.size(); i++) {
+			EXPECT_EQ(actual.projectiles[i].id, expected.projectiles[i].id);
+			EXPECT_EQ(actual.projectiles[i].x, expected.projectiles[i].x);
+			EXPECT_EQ(actual.projectiles[i].y, expected.projectiles[i].y);
+			EXPECT_EQ(actual.projectiles[i].z, expected.projectiles[i].z);
+		}
+	}
+}
+
+TEST(ReplayCodec, VarInt) {
+	const uint32_t values[] = { 0u, 1u, 127u, 128u, 300u, 16383u, 16384u, 0xffffffffu };
+	std::vector<uint8_t> data;
+	for (uint32_t value : values) {
+		WriteVarInt(data, value);
+	}
+	// small values take a byte
+	EXPECT_EQ(data[0], 0);
+	EXPECT_EQ(data[2], 127);
+
+	size_t offset = 0;
+	for (uint32_t value : values) {
+		uint32_t read = 0;
+		ASSERT_TRUE(ReadVarInt(data.data(), data.size(), offset, read));
+		EXPECT_EQ(read, value);
+	}
+	EXPECT_EQ(offset, data.size());
+
+	uint32_t read = 0;
+	EXPECT_FALSE(ReadVarInt(data.data(), data.size(), offset, read));
+}
+
+TEST(ReplayCodec, ZigZag) {
+	const int32_t values[] = { 0, 1, -1, 63, -64, 1000000, -1000000, INT32_MAX, INT32_MIN };
+	for (int32_t value : values) {
+		EXPECT_EQ(UnZigZag(ZigZag(value)), value);
+	}
+	EXPECT_EQ(ZigZag(0), 0u);
+	EXPECT_EQ(ZigZag(-1), 1u);
+	EXPECT_EQ(ZigZag(1), 2u);
+}
+
+TEST(ReplayCodec, RoundTrip) {
+	FReplayFrame keyframe;
+	keyframe.timeMs = 1500;
+	keyframe.characters = { MakeCharacter(1, 100, -200, 90, 65000, 60000, false), MakeCharacter(4, -3000, 50, 90, 10, 0, true) };
+	keyframe.projectiles = { MakeProjectile(7, 10, 20, 30) };
+
+	// a character joins, one moves and wraps its yaw around, one respawns, a projectile goes and another comes
+	FReplayFrame delta;
+	delta.timeMs = 1600;
+	delta.characters = { MakeCharacter(1, 130, -190, 90, 20, 55000, false), MakeCharacter(2, 5, 5, 5, 0, 65535, false), MakeCharacter(4, -3000, 50, 90, 10, 65535, false) };
+	delta.projectiles = { MakeProjectile(9, -40, 0, 12) };
+
+	// nothing changed
+	FReplayFrame still = delta;
+	still.timeMs = 1700;
+
+	std::vector<uint8_t> data;
+	EncodeFrame(keyframe, nullptr, data);
+	const size_t keyframeSize = data.size();
+	EncodeFrame(delta, &keyframe, data);
+	const size_t deltaEnd = data.size();
+	EncodeFrame(still, &delta, data);
+
+	// an unchanged frame costs a couple of bytes per entity
+	EXPECT_LT(data.size() - deltaEnd, keyframeSize);
+
+	size_t offset = 0;
+	FReplayFrame decodedKeyframe;
+	FReplayFrame decodedDelta;
+	FReplayFrame decodedStill;
+	ASSERT_TRUE(DecodeFrame(data.data(), data.size(), offset, nullptr, decodedKeyframe));
+	ASSERT_TRUE(DecodeFrame(data.data(), data.size(), offset, &decodedKeyframe, decodedDelta));
+	ASSERT_TRUE(DecodeFrame(data.data(), data.size(), offset, &decodedDelta, decodedStill));
+	EXPECT_EQ(offset, data.size());
+
+	ExpectFramesEqual(decodedKeyframe, keyframe);
+	ExpectFramesEqual(decodedDelta, delta);
+	ExpectFramesEqual(decodedStill, still);
+}
+
+TEST(ReplayCodec, DeltaNeedsPreviousFrame) {
+	FReplayFrame keyframe;
+	keyframe.timeMs = 100;
+	keyframe.characters = { MakeCharacter(1, 1, 2, 3, 4, 5, false) };
+
+	std::vector<uint8_t> data;
+	EncodeFrame(keyframe, &keyframe, data);
+
+	size_t offset = 0;
+	FReplayFrame decoded;
+	EXPECT_FALSE(DecodeFrame(data.data(), data.size(), offset, nullptr, decoded));
+}
+
+TEST(ReplayCodec, TruncatedData) {
+	FReplayFrame keyframe;
+	keyframe.timeMs = 100;
+	keyframe.characters = { MakeCharacter(1, 1000, 2000, 3000, 4000, 5000, false) };
+	keyframe.projectiles = { MakeProjectile(2, 100000, -100000, 7) };
+
+	std::vector<uint8_t> data;
+	EncodeFrame(keyframe, nullptr, data);
+
+	// every cut short frame fails instead of reading past the end
+	for (size_t size = 0; size < data.size(); size++) {
+		size_t offset = 0;
+		FReplayFrame decoded;
+		EXPECT_FALSE(DecodeFrame(data.data(), size, offset, nullptr, decoded)) << "size " << size;
+	}
+}